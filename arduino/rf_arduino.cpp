@@ -100,9 +100,17 @@ void arduino_tx_send_message(arduino_transmitter* self, RF_Message* message)
   self->transmitting = true;
 }
 
+void arduino_tx_send_bytes(arduino_transmitter* self, const uint8_t* data, uint8_t length)
+{
+  tx_send_bytes(&(self->tx_device), data, length);
+  self->transmitting = true;
+}
+
 void arduino_tx_init(arduino_transmitter* self, uint8_t pin)
 {
   DDRB |= (1 << TX_PIN);			//replaces pinMode(TX_PIN, OUTPUT);
   tx_init(&(self->tx_device), arduino_tx_set_signal, arduino_tx_set_onetime_trigger_time, 
-          arduino_tx_set_recurring_trigger_time, arduino_tx_cancel_trigger, transmit_ready_callback, self);
+          arduino_tx_set_recurring_trigger_time, arduino_tx_cancel_trigger, transmit_ready_callback, self, NULL);
+  // tx_callback only on level changes, the 100us ticks just count down the run
+  tx_set_edge_scheduling(&(self->tx_device), 1);
 }
@@ -20,7 +20,7 @@ typedef struct
 {  
     TX_Device tx_device;        
     bool one_shot_timer;        
-    uint8_t target_interrupt_count; 
+    uint16_t target_interrupt_count; 
     uint16_t interrupt_count;    
     bool one_shot_timer_triggered; 
     bool timer_initialized; 
@@ -49,6 +49,17 @@ void arduino_tx_init(arduino_transmitter* self, uint8_t pin);
  */
 void arduino_tx_send_message(arduino_transmitter* self, RF_Message* message);
 
+/**
+ * @brief Sends a byte frame using the Arduino transmitter.
+ * 
+ * The data is not copied and must stay valid while transmitting is set.
+ * 
+ * @param self Pointer to the arduino_transmitter structure.
+ * @param data Payload bytes.
+ * @param length Number of payload bytes.
+ */
+void arduino_tx_send_bytes(arduino_transmitter* self, const uint8_t* data, uint8_t length);
+
 
 #endif // RF_ARDUINO_H
 
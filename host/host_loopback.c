@@ -0,0 +1,641 @@
+/**
+ * @file host_loopback.c
+ * @brief TX -> RX loopback over the simulated host link.
+ *
+ * Sends a number of pseudo-random frames through the real TX and RX state machines and checks
+ * that every frame is received intact. A received frame is matched against the frames of its train
+ * not received yet, so a lost frame is counted as lost and does not fail the frames after it.
+ * Reports the decoding throughput.
+ *
+ * Usage: host-rf-loopback [frame_count] [sampled|edge|packed|edgesync|multi] [bytes] [4b6b|hamming] [queue]
+ *                         [train=<n>] [copies=<n>] [address=<n>] [runs] [compile] [pll] [repair] [stats] [trace]
+ *                         [capture=<file>] [bit_time=<us>] [tx_bit_time=<us>] [samples=<n>]
+ *                         [tolerance=<n>] [sync=<bits>]
+ *
+ * The mode selects whether the receiver gets every sample (rx_signal_callback), line edges
+ * (rx_edge_callback) or blocks of packed samples (rx_feed_samples). In multi mode the samples go
+ * to a multi-channel receiver (rx_multi_signal_callback) with the line on two channels and a third
+ * one idle: the frames must arrive on both line channels and nothing on the idle one. With
+ * "bytes" the frames are byte frames of up to MAX_PAYLOAD_BYTES bytes instead of 64-bit messages. With "4b6b" both ends
+ * use the 4b6b line coding, with "hamming" the Hamming(7,4) code. With "queue" messages are taken
+ * from the RX message queue with rx_poll_message instead of the result callback. With "train" n
+ * frames are queued back to back (up to TX_QUEUE_LENGTH + 1), sharing one wake-up and sync. With
+ * "copies" every frame is sent n times back to back and the receiver drops the repeats with the
+ * dedup filter (train is 1). With "address" the receiver filters on the device address (the low 4
+ * bits, see protocol.h), and every other message is sent to another address (train is 1). With
+ * "runs" the transmitter uses edge scheduling, one timer event per level change. With "compile"
+ * the frames are only queued (tx_set_manual_start), each train is compiled with tx_compile_runs
+ * and the runs are played onto the line by the host, as DMA would (train and copies up to
+ * TX_QUEUE_LENGTH). With "pll" the receiver tracks the bit phase, with "repair" it repairs frames
+ * failing the CRC from their least confident bits. With "stats" the RX and TX statistics are
+ * printed, with the handler durations in ns of wall time. With "trace" the trace events are
+ * counted per id, and the last ones printed with their virtual time. With "capture" the input of
+ * the receiver is recorded to the file for host-rf-replay (not with edgesync, the detected bit
+ * time is not recorded, nor with multi). bit_time, samples, tolerance and sync override the
+ * RF_Config of both ends, tx_bit_time the bit time of the transmitter only, to test clock
+ * mismatch. The options can be given in any order.
+ *
+ * Short preambles leave the receiver little room after a frame: "host-rf-loopback 300 edge sync=8"
+ * checks that it stops waiting for the next frame of a train as soon as a new preamble starts.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "rf_host.h"
+#include "rf_trace.h"
+#include "rf_capture.h"
+
+#define LOOPBACK_QUEUE_SIZE     8       // Holds a whole train
+#define LOOPBACK_MAX_TRAIN      (TX_QUEUE_LENGTH + 1)
+#define LOOPBACK_IDLE_GAP_BITS  10      // Idle line between frames, covers the edge and packed receiver latency
+#define LOOPBACK_DROP_GAP_BITS  (SYNC_SYMBOL_LENGTH + START_SYMBOL_LENGTH + LOOPBACK_IDLE_GAP_BITS)
+                                        // After a filtered frame, a false sync on its tail times out
+#define LOOPBACK_TRACE_SIZE     1024    // Records, drained after every train
+#define LOOPBACK_TRACE_EVENTS   8       // Event ids counted
+#define LOOPBACK_TRACE_LAST     8       // Records printed at the end
+#define LOOPBACK_CAPTURE_SIZE   65536   // Bytes, written to the capture file when full
+#define LOOPBACK_DEDUP_SIZE     4       // Entries of the dedup table
+#define LOOPBACK_ADDRESS_MASK   0xF     // PROTO_DEVICE_ADDRESS_MASK
+#define LOOPBACK_MULTI_COPY     5       // Multi mode: second channel on the line
+#define LOOPBACK_MULTI_IDLE     2       // Multi mode: channel without a signal
+#define LOOPBACK_COMPILE_RUNS   (TX_QUEUE_LENGTH * 4096)    // A train of byte frames of any coding
+
+static RF_Message expected[LOOPBACK_MAX_TRAIN + 1];   // The last one for frames the filter drops
+static uint8_t expected_bytes[LOOPBACK_MAX_TRAIN][MAX_PAYLOAD_BYTES];
+static uint8_t expected_byte_length[LOOPBACK_MAX_TRAIN];
+static uint8_t receive_buffer[MAX_PAYLOAD_BYTES];
+static RF_Message message_queue[LOOPBACK_QUEUE_SIZE];
+static RF_Trace_Record trace_buffer[LOOPBACK_TRACE_SIZE];
+static RF_Trace_Record trace_last[LOOPBACK_TRACE_LAST];
+static uint32_t trace_event_count[LOOPBACK_TRACE_EVENTS];
+static uint32_t trace_read_count;
+static uint8_t capture_buffer[LOOPBACK_CAPTURE_SIZE];
+static RX_Dedup_Entry dedup_table[LOOPBACK_DEDUP_SIZE];
+static uint32_t frames_sent;
+static TX_Run compiled_runs[LOOPBACK_COMPILE_RUNS];
+static RX_Multi_Device multi_device;
+static uint8_t copy_receive_buffer[MAX_PAYLOAD_BYTES];
+static RX_Dedup_Entry copy_dedup_table[LOOPBACK_DEDUP_SIZE];
+
+// Frames one channel received intact. Lost frames are skipped over, so they do not fail the next ones.
+typedef struct
+{
+    uint32_t next;                      // First frame of the train not received yet
+    uint32_t received;
+} loopback_channel;
+
+static loopback_channel main_channel;
+static loopback_channel copy_channel;   // Multi mode: the second line channel
+static uint32_t expected_count;         // Frames sent to the address of the receiver, numbered from 0
+static uint32_t mismatch_count;         // Frames received that match no frame of the train
+
+// Frame n is at n % LOOPBACK_MAX_TRAIN
+static uint32_t loopback_check_message(const RF_Message* message, uint32_t count)
+{
+    RF_Message const* expected_message = &expected[count % LOOPBACK_MAX_TRAIN];
+    return message->message != expected_message->message ||
+           message->message_length != expected_message->message_length ||
+           message->message_crc != expected_message->message_crc;
+}
+
+static uint32_t loopback_check_bytes(const uint8_t* data, uint8_t length, uint16_t crc, uint32_t count)
+{
+    uint8_t const index = count % LOOPBACK_MAX_TRAIN;
+    return length != expected_byte_length[index] ||
+           memcmp(data, expected_bytes[index], length) ||
+           crc != expected[index].message_crc;
+}
+
+// Frame n of the train is at n % LOOPBACK_MAX_TRAIN, the frames before channel->next are done
+static void loopback_match_message(loopback_channel* channel, const RF_Message* message)
+{
+    for (uint32_t n = channel->next; n < expected_count; n++)
+    {
+        if (!loopback_check_message(message, n))
+        {
+            channel->next = n + 1;
+            channel->received += 1;
+            return;
+        }
+    }
+    mismatch_count += 1;
+}
+
+static void loopback_match_bytes(loopback_channel* channel, const uint8_t* data, uint8_t length, uint16_t crc)
+{
+    for (uint32_t n = channel->next; n < expected_count; n++)
+    {
+        if (!loopback_check_bytes(data, length, crc, n))
+        {
+            channel->next = n + 1;
+            channel->received += 1;
+            return;
+        }
+    }
+    mismatch_count += 1;
+}
+
+static void loopback_result(RF_Message* message)
+{
+    loopback_match_message(&main_channel, message);
+}
+
+static void loopback_bytes_result(const uint8_t* data, uint8_t length, uint16_t crc)
+{
+    loopback_match_bytes(&main_channel, data, length, crc);
+}
+
+// Multi mode: the second line channel gets the same frames, without a queue
+static void loopback_copy_result(RF_Message* message)
+{
+    loopback_match_message(&copy_channel, message);
+}
+
+static void loopback_copy_bytes_result(const uint8_t* data, uint8_t length, uint16_t crc)
+{
+    loopback_match_bytes(&copy_channel, data, length, crc);
+}
+
+// Multi mode: nothing may arrive on the idle channel
+static void loopback_idle_result(RF_Message* message)
+{
+    mismatch_count += 1;
+}
+
+static uint32_t loopback_timestamp_ns(void* user_data)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t) (now.tv_sec * 1000000000ULL + now.tv_nsec);
+}
+
+// Dedup clock: the number of the frame being sent, so only its own copies fall within a window of 1
+static uint32_t loopback_dedup_time(void* user_data)
+{
+    return frames_sent;
+}
+
+static void loopback_print_isr_stats(const char* name, const RF_ISR_Stats* stats)
+{
+    printf("%s handler: %u calls, min %u ns, max %u ns\n", name, stats->count, 
+           stats->count ? stats->min : 0, stats->max);
+    for (uint8_t i = 0; i < RF_STATS_HISTOGRAM_BINS; i++)
+    {
+        if (stats->histogram[i] && i < RF_STATS_HISTOGRAM_BINS - 1)
+        {
+            printf("  <  %6u ns: %u\n", 1U << i, stats->histogram[i]);
+        }
+        else if (stats->histogram[i])
+        {
+            printf("  >= %6u ns: %u\n", 1U << (i - 1), stats->histogram[i]);
+        }
+    }
+}
+
+static void loopback_print_stats(const RX_Stats* rx_stats, const TX_Stats* tx_stats)
+{
+    static const char* const loss_names[RX_LOSS_COUNT] = 
+        { "sample", "no start", "end of train", "length", "symbol", "crc", "filtered" };
+    static const char* const state_names[RX_STATE_COUNT] = 
+        { "sync", "wait delay", "wait start", "length", "payload", "bytes", "crc" };
+
+    printf("TX: %u queued, %u sent, %u rejected\n", tx_stats->frames_queued, tx_stats->frames_sent, 
+           tx_stats->queue_full_count);
+    printf("RX: %u syncs, %u frames, %u bits corrected, %u frames repaired, %u duplicates dropped\n",
+           rx_stats->sync_count, rx_stats->frames_received, rx_stats->corrected_bits, rx_stats->repaired_frames,
+           rx_stats->duplicate_frames);
+    for (uint8_t i = 0; i < RX_LOSS_COUNT; i++)
+    {
+        printf("  lost sync, %s: %u\n", loss_names[i], rx_stats->sync_losses[i]);
+    }
+    for (uint8_t i = 0; i < RX_STATE_COUNT; i++)
+    {
+        printf("  samples in %s: %u\n", state_names[i], rx_stats->state_samples[i]);
+    }
+    loopback_print_isr_stats("RX", &(rx_stats->isr));
+    loopback_print_isr_stats("TX", &(tx_stats->isr));
+}
+
+static uint32_t loopback_trace_timestamp(void* user_data)
+{
+    rf_host_link* const link = (rf_host_link*) user_data;
+    return (uint32_t) link->now_us;
+}
+
+static void loopback_drain_trace(void)
+{
+    RF_Trace_Record record;
+    while (rf_trace_read(&record))
+    {
+        trace_event_count[record.event < LOOPBACK_TRACE_EVENTS ? record.event : 0] += 1;
+        trace_last[trace_read_count % LOOPBACK_TRACE_LAST] = record;
+        trace_read_count += 1;
+    }
+}
+
+static void loopback_print_trace(void)
+{
+    char text[64];
+    printf("Trace: %u records read, %u lost\n", trace_read_count, rf_trace_lost_count());
+    for (uint8_t i = 1; i < LOOPBACK_TRACE_EVENTS; i++)
+    {
+        if (trace_event_count[i])
+        {
+            printf("  %s: %u\n", rf_trace_event_name(i), trace_event_count[i]);
+        }
+    }
+    uint32_t const first = trace_read_count > LOOPBACK_TRACE_LAST ? trace_read_count - LOOPBACK_TRACE_LAST : 0;
+    for (uint32_t i = first; i < trace_read_count; i++)
+    {
+        rf_trace_format(&trace_last[i % LOOPBACK_TRACE_LAST], text, sizeof(text));
+        printf("  %s\n", text);
+    }
+}
+
+static void loopback_write_capture(const uint8_t* data, size_t length, void* user_data)
+{
+    fwrite(data, 1, length, (FILE*) user_data);
+}
+
+static uint64_t loopback_random(uint64_t* state)
+{
+    // xorshift64
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t frame_count = 1000;
+    rf_host_rx_mode mode = HOST_RX_SAMPLED;
+    uint8_t byte_frames = 0;
+    RF_Line_Coding coding = RF_LINE_CODING_NRZ;
+    RF_Config config = RF_CONFIG_DEFAULT;
+    uint8_t use_queue = 0;
+    uint32_t train_length = 1;
+    uint32_t copies = 1;
+    int16_t filter_address = -1;
+    uint8_t edge_scheduled = 0;
+    uint8_t compiled = 0;
+    uint8_t phase_tracking = 0;
+    uint8_t crc_repair = 0;
+    uint8_t print_stats = 0;
+    uint8_t trace = 0;
+    uint16_t tx_bit_time = 0;
+    const char* capture_path = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "sampled"))
+        {
+            mode = HOST_RX_SAMPLED;
+        }
+        else if (!strcmp(argv[i], "edge"))
+        {
+            mode = HOST_RX_EDGE;
+        }
+        else if (!strcmp(argv[i], "packed"))
+        {
+            mode = HOST_RX_PACKED;
+        }
+        else if (!strcmp(argv[i], "edgesync"))
+        {
+            mode = HOST_RX_EDGE_SYNC;
+        }
+        else if (!strcmp(argv[i], "multi"))
+        {
+            mode = HOST_RX_MULTI;
+        }
+        else if (!strcmp(argv[i], "bytes"))
+        {
+            byte_frames = 1;
+        }
+        else if (!strcmp(argv[i], "4b6b"))
+        {
+            coding = RF_LINE_CODING_4B6B;
+        }
+        else if (!strcmp(argv[i], "hamming"))
+        {
+            coding = RF_LINE_CODING_HAMMING74;
+        }
+        else if (!strcmp(argv[i], "queue"))
+        {
+            use_queue = 1;
+        }
+        else if (!strcmp(argv[i], "runs"))
+        {
+            edge_scheduled = 1;
+        }
+        else if (!strcmp(argv[i], "compile"))
+        {
+            compiled = 1;
+        }
+        else if (!strcmp(argv[i], "trace"))
+        {
+            trace = 1;
+        }
+        else if (!strcmp(argv[i], "stats"))
+        {
+            print_stats = 1;
+        }
+        else if (!strcmp(argv[i], "pll"))
+        {
+            phase_tracking = 1;
+        }
+        else if (!strcmp(argv[i], "repair"))
+        {
+            crc_repair = 1;
+        }
+        else if (!strncmp(argv[i], "train=", 6))
+        {
+            train_length = (uint32_t) strtoul(argv[i] + 6, NULL, 10);
+            if (train_length < 1 || train_length > LOOPBACK_MAX_TRAIN)
+            {
+                train_length = LOOPBACK_MAX_TRAIN;
+            }
+        }
+        else if (!strncmp(argv[i], "copies=", 7))
+        {
+            copies = (uint32_t) strtoul(argv[i] + 7, NULL, 10);
+            if (copies < 1 || copies > LOOPBACK_MAX_TRAIN)
+            {
+                copies = copies < 1 ? 1 : LOOPBACK_MAX_TRAIN;
+            }
+        }
+        else if (!strncmp(argv[i], "address=", 8))
+        {
+            filter_address = (int16_t) (strtoul(argv[i] + 8, NULL, 10) & LOOPBACK_ADDRESS_MASK);
+        }
+        else if (!strncmp(argv[i], "capture=", 8))
+        {
+            capture_path = argv[i] + 8;
+        }
+        else if (!strncmp(argv[i], "bit_time=", 9))
+        {
+            config.bit_time = (uint16_t) strtoul(argv[i] + 9, NULL, 10);
+        }
+        else if (!strncmp(argv[i], "tx_bit_time=", 12))
+        {
+            tx_bit_time = (uint16_t) strtoul(argv[i] + 12, NULL, 10);
+        }
+        else if (!strncmp(argv[i], "samples=", 8))
+        {
+            config.sampling_count = (uint8_t) strtoul(argv[i] + 8, NULL, 10);
+        }
+        else if (!strncmp(argv[i], "tolerance=", 10))
+        {
+            config.sampling_tolerance = (uint8_t) strtoul(argv[i] + 10, NULL, 10);
+        }
+        else if (!strncmp(argv[i], "sync=", 5))
+        {
+            config.sync_symbol_length = (uint8_t) strtoul(argv[i] + 5, NULL, 10);
+        }
+        else
+        {
+            frame_count = (uint32_t) strtoul(argv[i], NULL, 10);
+        }
+    }
+    if (compiled)
+    {
+        // Nothing is sent before the train is compiled, so it must fit in the queue
+        train_length = train_length > TX_QUEUE_LENGTH ? TX_QUEUE_LENGTH : train_length;
+        copies = copies > TX_QUEUE_LENGTH ? TX_QUEUE_LENGTH : copies;
+    }
+    if (rf_config_clamp(&config))
+    {
+        // The devices would do the same
+        fprintf(stderr, "config: adjusted to samples=%u tolerance=%u sync=%u bit_time=%u\n",
+                config.sampling_count, config.sampling_tolerance, config.sync_symbol_length, config.bit_time);
+    }
+    uint64_t random_state = 0x9E3779B97F4A7C15ULL;
+    RF_Config tx_config = config;
+    if (tx_bit_time)
+    {
+        tx_config.bit_time = tx_bit_time;
+    }
+
+    rf_host_link link;
+    rf_host_transmitter transmitter;
+    rf_host_receiver receiver;
+
+    host_init_link(&link);
+    host_init_transmitter(&transmitter, &link, &tx_config);
+    host_init_receiver(&receiver, &link, loopback_result, &config);
+    RX_Device* rx_device = &(receiver.rx_device);
+    RX_Device* copy_device = NULL;
+    if (mode == HOST_RX_MULTI)
+    {
+        host_rx_set_multi(&receiver, &multi_device, (1UL << 0) | (1UL << LOOPBACK_MULTI_COPY));
+        rx_multi_add_channel(&multi_device, 0, loopback_result);
+        rx_multi_add_channel(&multi_device, LOOPBACK_MULTI_COPY, loopback_copy_result);
+        rx_multi_add_channel(&multi_device, LOOPBACK_MULTI_IDLE, loopback_idle_result);
+        // The first channel is set up and checked like the single receiver
+        rx_device = &(multi_device.channels[0]);
+        copy_device = &(multi_device.channels[LOOPBACK_MULTI_COPY]);
+        rx_set_line_coding(copy_device, coding);
+        rx_set_line_coding(&(multi_device.channels[LOOPBACK_MULTI_IDLE]), coding);
+    }
+    else
+    {
+        host_rx_set_mode(&receiver, mode);
+    }
+    tx_set_line_coding(&(transmitter.tx_device), coding);
+    tx_set_edge_scheduling(&(transmitter.tx_device), edge_scheduled);
+    tx_set_manual_start(&(transmitter.tx_device), compiled);
+    rx_set_line_coding(rx_device, coding);
+    rx_set_phase_tracking(rx_device, phase_tracking);
+    rx_set_crc_repair(rx_device, crc_repair);
+    if (print_stats)
+    {
+        rx_set_timestamp_hook(rx_device, loopback_timestamp_ns);
+        tx_set_timestamp_hook(&(transmitter.tx_device), loopback_timestamp_ns);
+    }
+    if (byte_frames || filter_address < 0)
+    {
+        // Not with the filter, the tail of a dropped message could be taken for a byte frame
+        rx_set_byte_buffer(rx_device, receive_buffer, sizeof(receive_buffer), loopback_bytes_result);
+        if (copy_device)
+        {
+            rx_set_byte_buffer(copy_device, copy_receive_buffer, sizeof(copy_receive_buffer),
+                               loopback_copy_bytes_result);
+        }
+    }
+    if (copies > 1)
+    {
+        train_length = 1;
+        rx_set_dedup_filter(rx_device, dedup_table, LOOPBACK_DEDUP_SIZE, 1, 0, loopback_dedup_time);
+        if (copy_device)
+        {
+            rx_set_dedup_filter(copy_device, copy_dedup_table, LOOPBACK_DEDUP_SIZE, 1, 0, loopback_dedup_time);
+        }
+    }
+    if (filter_address >= 0)
+    {
+        train_length = 1;
+        rx_set_message_filter(rx_device, LOOPBACK_ADDRESS_MASK, filter_address);
+        if (copy_device)
+        {
+            rx_set_message_filter(copy_device, LOOPBACK_ADDRESS_MASK, filter_address);
+        }
+    }
+    if (use_queue)
+    {
+        rx_set_message_queue(rx_device, message_queue, LOOPBACK_QUEUE_SIZE);
+    }
+    if (trace)
+    {
+        rf_trace_init(trace_buffer, LOOPBACK_TRACE_SIZE, loopback_trace_timestamp, &link);
+    }
+    RF_Capture capture;
+    FILE* capture_file = NULL;
+    if (capture_path && (mode == HOST_RX_EDGE_SYNC || mode == HOST_RX_MULTI))
+    {
+        fprintf(stderr, "capture: not supported with edgesync or multi\n");
+    }
+    else if (capture_path)
+    {
+        capture_file = fopen(capture_path, "wb");
+        if (!capture_file)
+        {
+            perror(capture_path);
+            return 2;
+        }
+        rf_capture_init(&capture, mode == HOST_RX_EDGE ? RF_CAPTURE_EDGES : RF_CAPTURE_SAMPLES,
+                        capture_buffer, sizeof(capture_buffer), loopback_write_capture, capture_file);
+        rx_set_capture(rx_device, &capture);
+    }
+    host_rx_start_receiving(&receiver);
+
+    struct timespec start, end;
+    uint32_t filtered_count = 0;
+    uint32_t compiled_run_count = 0;
+    uint32_t compile_failures = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (uint32_t i = 0; i < frame_count; i++)
+    {
+        uint8_t const filtered = filter_address >= 0 && !byte_frames && (i & 1);
+        uint8_t const index = filtered ? LOOPBACK_MAX_TRAIN : (i - filtered_count) % LOOPBACK_MAX_TRAIN;
+        frames_sent = i;
+        RF_Message* const message = &expected[index];
+        message->message_length = 1 + loopback_random(&random_state) % MAX_PAYLOAD_LENGTH;
+        message->message = loopback_random(&random_state);
+        if (filter_address >= 0 && message->message_length < 4)
+        {
+            // Room for the address
+            message->message_length = 4;
+        }
+        if (message->message_length < 64)
+        {
+            message->message &= (1ULL << message->message_length) - 1;
+        }
+        if (filter_address >= 0)
+        {
+            message->message &= ~(uint64_t) LOOPBACK_ADDRESS_MASK;
+            message->message |= filtered ? (filter_address + 1) & LOOPBACK_ADDRESS_MASK : filter_address;
+            filtered_count += filtered;
+        }
+        expected_count += !filtered;
+        message->message_crc = rf_crc16_message(message);
+
+        if (byte_frames)
+        {
+            expected_byte_length[index] = 1 + loopback_random(&random_state) % MAX_PAYLOAD_BYTES;
+            for (uint16_t j = 0; j < expected_byte_length[index]; j++)
+            {
+                expected_bytes[index][j] = (uint8_t) loopback_random(&random_state);
+            }
+            message->message_crc = rf_crc16_bytes(expected_bytes[index], expected_byte_length[index]);
+            for (uint32_t j = 0; j < copies; j++)
+            {
+                host_tx_send_bytes(&transmitter, expected_bytes[index], expected_byte_length[index]);
+            }
+        }
+        else
+        {
+            for (uint32_t j = 0; j < copies; j++)
+            {
+                host_tx_send_message(&transmitter, message);
+            }
+        }
+        if ((i + 1) % train_length && i + 1 < frame_count)
+        {
+            // Queue the rest of the train before sending
+            continue;
+        }
+        if (compiled)
+        {
+            int16_t const run_count = tx_compile_runs(&(transmitter.tx_device), compiled_runs, LOOPBACK_COMPILE_RUNS);
+            if (run_count > 0)
+            {
+                compiled_run_count += run_count;
+                host_tx_play_runs(&transmitter, compiled_runs, run_count);
+            }
+            else
+            {
+                compile_failures += 1;
+            }
+        }
+        while (host_tx_is_busy(&transmitter))
+        {
+            host_link_step(&link);
+        }
+        // Let the receiver finish the last bit and idle before the next frame
+        host_link_run_until(&link, link.now_us + (filtered ? LOOPBACK_DROP_GAP_BITS : LOOPBACK_IDLE_GAP_BITS) *
+                                               config.bit_time);
+
+        RF_Message received;
+        while (rx_poll_message(rx_device, &received))
+        {
+            loopback_result(&received);
+        }
+        // Frames of the train not received by now are lost
+        main_channel.next = expected_count;
+        copy_channel.next = expected_count;
+        loopback_drain_trace();
+    }
+    host_rx_stop_receiving(&receiver);
+    if (capture_file)
+    {
+        rf_capture_finish(&capture);
+        fclose(capture_file);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double const elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    printf("Frames sent: %u, received: %u, lost: %u, mismatched: %u\n", frame_count, main_channel.received,
+           expected_count - main_channel.received, mismatch_count);
+    if (compiled)
+    {
+        printf("Runs compiled: %u, failed trains: %u\n", compiled_run_count, compile_failures);
+    }
+    if (mode == HOST_RX_MULTI)
+    {
+        printf("Frames on the second channel: %u, lost: %u\n", copy_channel.received,
+               expected_count - copy_channel.received);
+    }
+    if (filter_address >= 0)
+    {
+        printf("Frames for other addresses: %u, filtered: %u\n", filtered_count,
+               rx_device->stats.sync_losses[RX_LOSS_FILTERED]);
+    }
+    printf("TX timer events: %u\n", transmitter.trigger_count);
+    if (print_stats)
+    {
+        loopback_print_stats(&(rx_device->stats), &(transmitter.tx_device.stats));
+    }
+    if (trace)
+    {
+        loopback_print_trace();
+    }
+    printf("Simulated air time: %.3f s, wall time: %.3f s, %.0f frames/s\n",
+           link.now_us / 1e6, elapsed, elapsed > 0 ? frame_count / elapsed : 0.0);
+
+    return (main_channel.received == expected_count && !mismatch_count && !compile_failures &&
+            (mode != HOST_RX_MULTI || copy_channel.received == expected_count)) ? 0 : 1;
+}
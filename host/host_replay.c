@@ -0,0 +1,273 @@
+/**
+ * @file host_replay.c
+ * @brief Replays a capture of the RX input through the RX device.
+ *
+ * Memory-maps a capture written with rx_set_capture (see rf_capture.h) and feeds it to a fresh RX
+ * device, set up from the config, line coding, phase tracking and CRC repair in the capture
+ * header. Nothing is timed, the records are replayed as fast as the receiver decodes them. The
+ * same capture gives the same frames and statistics as the reception it was recorded from, so
+ * field failures can be reproduced offline and captured traffic used for regression and
+ * performance testing.
+ *
+ * Usage: host-rf-replay <capture> [sampled|packed] [quiet] [stats] [repeat=<n>]
+ *
+ * Sample captures are fed sample by sample to rx_signal_callback, or with "packed" in blocks to
+ * rx_feed_samples. Edge captures are fed to rx_edge_callback and rx_edge_flush. Every frame is
+ * printed, one line each, unless "quiet" is given. With "stats" the RX statistics are printed.
+ * With "repeat" the capture is replayed n times for timing.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "rf_device.h"
+#include "rf_capture.h"
+
+#define REPLAY_PACKED_WORDS     256     // Samples handed to rx_feed_samples at a time, / 32
+
+static uint8_t receive_buffer[MAX_PAYLOAD_BYTES];
+static uint32_t packed_samples[REPLAY_PACKED_WORDS];
+static uint32_t packed_count;
+static uint32_t frame_count;
+static uint8_t print_frames = 1;
+
+static void replay_result(RF_Message* message)
+{
+    frame_count += 1;
+    if (print_frames)
+    {
+        printf("message %2u %016llx crc %04x\n", message->message_length,
+               (unsigned long long) message->message, message->message_crc);
+    }
+}
+
+static void replay_bytes_result(const uint8_t* data, uint8_t length, uint16_t crc)
+{
+    frame_count += 1;
+    if (print_frames)
+    {
+        printf("bytes %3u ", length);
+        for (uint16_t i = 0; i < length; i++)
+        {
+            printf("%02x", data[i]);
+        }
+        printf(" crc %04x\n", crc);
+    }
+}
+
+static void replay_set_recurring_trigger_time(uint64_t time_to_trigger, void* user_data)
+{
+    // The records are the triggers
+}
+
+static void replay_cancel_trigger(void* user_data)
+{
+}
+
+static void replay_flush_packed(RX_Device* rx_device)
+{
+    if (packed_count)
+    {
+        rx_feed_samples(rx_device, packed_samples, packed_count);
+        memset(packed_samples, 0, sizeof(packed_samples));
+        packed_count = 0;
+    }
+}
+
+static void replay_pack_run(RX_Device* rx_device, uint8_t level, uint32_t length)
+{
+    while (length)
+    {
+        uint32_t take = 32 - (packed_count & 31);
+        if (take > length)
+        {
+            take = length;
+        }
+        if (level)
+        {
+            uint32_t const mask = take == 32 ? 0xFFFFFFFFUL : ((1UL << take) - 1);
+            packed_samples[packed_count >> 5] |= mask << (packed_count & 31);
+        }
+        packed_count += take;
+        length -= take;
+        if (packed_count == REPLAY_PACKED_WORDS * 32)
+        {
+            replay_flush_packed(rx_device);
+        }
+    }
+}
+
+// Returns the number of records replayed
+static uint64_t replay_capture(RX_Device* rx_device, const uint8_t* data, size_t length, uint8_t packed,
+                               uint64_t* sample_count)
+{
+    RF_Capture_Reader reader;
+    RF_Capture_Record record;
+    uint64_t record_count = 0;
+
+    rf_capture_open(&reader, data, length);
+    if (reader.header.kind == RF_CAPTURE_EDGES)
+    {
+        rx_start_edge_receiving(rx_device);
+    }
+    else
+    {
+        rx_start_receiving(rx_device);
+    }
+    while (rf_capture_read(&reader, &record))
+    {
+        record_count += 1;
+        switch (record.type)
+        {
+            case RF_CAPTURE_RUN:
+                *sample_count += record.value;
+                if (packed)
+                {
+                    replay_pack_run(rx_device, record.level, record.value);
+                }
+                else
+                {
+                    for (uint32_t i = 0; i < record.value; i++)
+                    {
+                        rx_signal_callback(rx_device, record.level);
+                    }
+                }
+                break;
+            case RF_CAPTURE_EDGE:
+                rx_edge_callback(rx_device, record.value, record.level);
+                break;
+            default:
+                rx_edge_flush(rx_device, record.value);
+                break;
+        }
+    }
+    replay_flush_packed(rx_device);
+    if (reader.position != length)
+    {
+        fprintf(stderr, "Truncated record at byte %zu\n", reader.position);
+    }
+    return record_count;
+}
+
+static void replay_print_stats(const RX_Stats* stats)
+{
+    static const char* const loss_names[RX_LOSS_COUNT] =
+        { "sample", "no start", "end of train", "length", "symbol", "crc", "filtered" };
+    static const char* const state_names[RX_STATE_COUNT] =
+        { "sync", "wait delay", "wait start", "length", "payload", "bytes", "crc" };
+
+    printf("RX: %u syncs, %u frames\n", stats->sync_count, stats->frames_received);
+    for (uint8_t i = 0; i < RX_LOSS_COUNT; i++)
+    {
+        printf("  lost sync, %s: %u\n", loss_names[i], stats->sync_losses[i]);
+    }
+    for (uint8_t i = 0; i < RX_STATE_COUNT; i++)
+    {
+        printf("  samples in %s: %u\n", state_names[i], stats->state_samples[i]);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char* path = NULL;
+    uint8_t packed = 0;
+    uint8_t print_stats = 0;
+    uint32_t repeat = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "sampled"))
+        {
+            packed = 0;
+        }
+        else if (!strcmp(argv[i], "packed"))
+        {
+            packed = 1;
+        }
+        else if (!strcmp(argv[i], "quiet"))
+        {
+            print_frames = 0;
+        }
+        else if (!strcmp(argv[i], "stats"))
+        {
+            print_stats = 1;
+        }
+        else if (!strncmp(argv[i], "repeat=", 7))
+        {
+            repeat = (uint32_t) strtoul(argv[i] + 7, NULL, 10);
+            if (!repeat)
+            {
+                repeat = 1;
+            }
+        }
+        else
+        {
+            path = argv[i];
+        }
+    }
+    if (!path)
+    {
+        fprintf(stderr, "Usage: %s <capture> [sampled|packed] [quiet] [stats] [repeat=<n>]\n", argv[0]);
+        return 2;
+    }
+
+    int const fd = open(path, O_RDONLY);
+    struct stat file_stat;
+    if (fd < 0 || fstat(fd, &file_stat) < 0)
+    {
+        perror(path);
+        return 2;
+    }
+    size_t const length = (size_t) file_stat.st_size;
+    const uint8_t* const data = length ? mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    RF_Capture_Reader reader;
+    if (data == MAP_FAILED || rf_capture_open(&reader, data, length) < 0)
+    {
+        fprintf(stderr, "%s: not a capture\n", path);
+        return 2;
+    }
+    madvise((void*) data, length, MADV_SEQUENTIAL);
+
+    RX_Device rx_device;
+    uint64_t record_count = 0;
+    uint64_t sample_count = 0;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (uint32_t i = 0; i < repeat; i++)
+    {
+        rx_init(&rx_device, replay_result, replay_set_recurring_trigger_time, replay_cancel_trigger,
+                NULL, &(reader.header.config));
+        rx_set_line_coding(&rx_device, reader.header.line_coding);
+        rx_set_phase_tracking(&rx_device, reader.header.flags & RF_CAPTURE_PHASE_TRACKING);
+        rx_set_crc_repair(&rx_device, (reader.header.flags & RF_CAPTURE_CRC_REPAIR) ? 1 : 0);
+        rx_set_byte_buffer(&rx_device, receive_buffer, sizeof(receive_buffer), replay_bytes_result);
+        record_count += replay_capture(&rx_device, data, length, packed, &sample_count);
+        print_frames = 0;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double const elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    if (print_stats)
+    {
+        replay_print_stats(&(rx_device.stats));
+    }
+    printf("Capture: %s, %zu bytes, %s, bit time %u us, %u samples/bit\n", path, length,
+           reader.header.kind == RF_CAPTURE_EDGES ? "edges" : "samples",
+           reader.header.config.bit_time, reader.header.config.sampling_count);
+    printf("Frames: %u, records: %llu, samples: %llu\n", frame_count / repeat,
+           (unsigned long long) (record_count / repeat), (unsigned long long) (sample_count / repeat));
+    printf("Wall time: %.3f s, %.1f MB/s, %.0f samples/s\n", elapsed,
+           elapsed > 0 ? (double) length * repeat / elapsed / 1e6 : 0.0,
+           elapsed > 0 ? sample_count / elapsed : 0.0);
+
+    munmap((void*) data, length);
+    return 0;
+}
@@ -0,0 +1,417 @@
+#include <string.h>
+#include <stdlib.h>
+#include "rf_host.h"
+#include "debug_logging.h"
+
+// Stretches a duration by the clock error of the timer, carrying the fraction of a us over
+static uint64_t host_timer_skew(rf_host_timer* timer, uint64_t duration)
+{
+    if (!timer->skew_ppm)
+    {
+        return duration;
+    }
+    timer->skew_residue += (int64_t) duration * timer->skew_ppm;
+    int64_t const adjust = timer->skew_residue / 1000000;
+    timer->skew_residue -= adjust * 1000000;
+    return duration + adjust;
+}
+
+static void host_timer_arm(rf_host_timer* timer, uint64_t now_us, uint64_t time_to_trigger, uint8_t recurring)
+{
+    timer->deadline = now_us + host_timer_skew(timer, time_to_trigger);
+    timer->period = recurring ? time_to_trigger : 0;
+    timer->armed = 1;
+}
+
+// Moves the timer to its next deadline before the callback runs, so the callback may re-arm or cancel it
+static void host_timer_consume(rf_host_timer* timer)
+{
+    if (timer->period)
+    {
+        timer->deadline += host_timer_skew(timer, timer->period);
+    }
+    else
+    {
+        timer->armed = 0;
+    }
+}
+
+static uint32_t host_channel_random(rf_host_channel* self)
+{
+    // xorshift64
+    self->random_state ^= self->random_state << 13;
+    self->random_state ^= self->random_state >> 7;
+    self->random_state ^= self->random_state << 17;
+    return (uint32_t) (self->random_state >> 32);
+}
+
+// Level of the line at the receiver, through the channel
+static uint8_t host_channel_sample(rf_host_link* link)
+{
+    rf_host_channel* const channel = link->channel;
+    uint8_t level = link->line_level;
+    if (!channel)
+    {
+        return level;
+    }
+    if (link->now_us < channel->edge_time)
+    {
+        // The latest edge has not arrived yet
+        level = channel->previous_level;
+    }
+    if (channel->burst_left)
+    {
+        channel->burst_left -= 1;
+        return host_channel_random(channel) & 1;
+    }
+    if (channel->burst_threshold && host_channel_random(channel) < channel->burst_threshold)
+    {
+        channel->burst_left = channel->burst_length ? channel->burst_length - 1 : 0;
+        return host_channel_random(channel) & 1;
+    }
+    uint8_t const idle = !link->transmitter || !host_tx_is_busy(link->transmitter);
+    uint32_t const threshold = idle ? channel->idle_flip_threshold : channel->flip_threshold;
+    if (threshold && host_channel_random(channel) < threshold)
+    {
+        level ^= 1;
+    }
+    return level;
+}
+
+// Callback functions
+
+static void host_tx_set_signal(uint8_t is_high, void* user_data)
+{
+    rf_host_transmitter* transmitter = (rf_host_transmitter*) user_data;
+    rf_host_link* const link = transmitter->link;
+    uint8_t const level = is_high ? 1 : 0;
+    uint64_t edge_time = link->now_us;
+
+    if (level != link->line_level && link->channel)
+    {
+        rf_host_channel* const channel = link->channel;
+        if (channel->jitter_us)
+        {
+            edge_time += host_channel_random(channel) % (channel->jitter_us + 1);
+        }
+        channel->edge_time = edge_time;
+        channel->previous_level = link->line_level;
+    }
+    if (level != link->line_level && link->receiver && link->receiver->mode == HOST_RX_EDGE)
+    {
+        rf_host_receiver* const receiver = link->receiver;
+        rx_edge_callback(&(receiver->rx_device), (uint32_t) edge_time, level);
+        host_timer_arm(&(receiver->timer), link->now_us,
+                       RX_EDGE_FLUSH_BITS * receiver->rx_device.sync_rate + receiver->rx_device.sync_rate / 2, 0);
+    }
+    if (level != link->line_level && link->receiver && link->receiver->mode == HOST_RX_EDGE_SYNC)
+    {
+        rx_edge_sync_callback(&(link->receiver->synchronizer), (uint32_t) edge_time, level);
+    }
+    link->line_level = level;
+}
+
+static void host_tx_set_onetime_trigger_time(uint64_t time_to_trigger, void* user_data)
+{
+    rf_host_transmitter* transmitter = (rf_host_transmitter*) user_data;
+    host_timer_arm(&(transmitter->timer), transmitter->link->now_us, time_to_trigger, 0);
+}
+
+static void host_tx_set_recurring_trigger_time(uint64_t time_to_trigger, void* user_data)
+{
+    rf_host_transmitter* transmitter = (rf_host_transmitter*) user_data;
+    host_timer_arm(&(transmitter->timer), transmitter->link->now_us, time_to_trigger, 1);
+}
+
+static void host_tx_cancel_trigger(void* user_data)
+{
+    rf_host_transmitter* transmitter = (rf_host_transmitter*) user_data;
+    transmitter->timer.armed = 0;
+}
+
+static void host_tx_ready_callback(void* user_data)
+{
+    // Nothing to do, host_tx_is_busy() follows the TX state
+}
+
+// Sets the line for the next compiled run, or ends the playback
+static void host_tx_play_next_run(rf_host_transmitter* self)
+{
+    if (self->run_index < self->run_count)
+    {
+        TX_Run const* run = &(self->runs[self->run_index]);
+        self->run_index += 1;
+        host_tx_set_signal(run->level, self);
+        host_timer_arm(&(self->timer), self->link->now_us, run->duration, 0);
+        return;
+    }
+    host_tx_set_signal(0, self);
+    self->runs = NULL;
+}
+
+static void host_rx_set_recurring_trigger_time(uint64_t time_to_trigger, void* user_data)
+{
+    rf_host_receiver* receiver = (rf_host_receiver*) user_data;
+    host_timer_arm(&(receiver->timer), receiver->link->now_us, time_to_trigger, 1);
+}
+
+// Called from the trigger callback, after the timer already moved to the next deadline
+static void host_rx_set_trigger_period(uint32_t period, void* user_data)
+{
+    rf_host_receiver* receiver = (rf_host_receiver*) user_data;
+    receiver->timer.deadline = receiver->timer.deadline - receiver->timer.period + period;
+    receiver->timer.period = period;
+}
+
+static void host_rx_cancel_trigger(void* user_data)
+{
+    rf_host_receiver* receiver = (rf_host_receiver*) user_data;
+    receiver->timer.armed = 0;
+}
+
+// Callback functions end
+
+static void host_rx_flush_samples(rf_host_receiver* self)
+{
+    if (self->sample_count)
+    {
+        rx_feed_samples(&(self->rx_device), self->samples, self->sample_count);
+        memset(self->samples, 0, sizeof(self->samples));
+        self->sample_count = 0;
+    }
+}
+
+static void host_rx_collect_sample(rf_host_receiver* self, uint8_t level)
+{
+    self->samples[self->sample_count >> 5] |= (uint32_t) level << (self->sample_count & 31);
+    self->sample_count += 1;
+    if (self->sample_count == HOST_RX_PACKED_WORDS * 32)
+    {
+        host_rx_flush_samples(self);
+    }
+}
+
+void host_init_link(rf_host_link* self)
+{
+    memset(self, 0, sizeof(rf_host_link));
+}
+
+static uint32_t host_channel_threshold(double probability)
+{
+    if (probability <= 0)
+    {
+        return 0;
+    }
+    if (probability >= 1)
+    {
+        return UINT32_MAX;
+    }
+    return (uint32_t) (probability * 4294967296.0);
+}
+
+void host_init_channel(rf_host_channel* self, const rf_host_channel_config* config, uint64_t seed)
+{
+    memset(self, 0, sizeof(rf_host_channel));
+    self->flip_threshold = host_channel_threshold(config->flip);
+    self->idle_flip_threshold = host_channel_threshold(config->idle_flip);
+    self->burst_threshold = host_channel_threshold(config->burst_rate);
+    self->burst_length = config->burst_length;
+    self->jitter_us = config->jitter_us;
+    self->skew_ppm = config->skew_ppm;
+    self->random_state = seed ? seed : 1;
+}
+
+void host_link_set_channel(rf_host_link* self, rf_host_channel* channel)
+{
+    self->channel = channel;
+    if (self->transmitter)
+    {
+        self->transmitter->timer.skew_ppm = channel ? channel->skew_ppm : 0;
+        self->transmitter->timer.skew_residue = 0;
+    }
+}
+
+uint8_t host_link_step(rf_host_link* self)
+{
+    rf_host_transmitter* const transmitter = self->transmitter;
+    rf_host_receiver* const receiver = self->receiver;
+    uint8_t const tx_armed = transmitter && transmitter->timer.armed;
+    uint8_t const rx_armed = receiver && receiver->timer.armed;
+
+    if (tx_armed && (!rx_armed || transmitter->timer.deadline <= receiver->timer.deadline))
+    {
+        self->now_us = transmitter->timer.deadline;
+        host_timer_consume(&(transmitter->timer));
+        transmitter->trigger_count += 1;
+        if (transmitter->runs)
+        {
+            host_tx_play_next_run(transmitter);
+        }
+        else
+        {
+            tx_callback(&(transmitter->tx_device));
+        }
+        return 1;
+    }
+    if (rx_armed)
+    {
+        self->now_us = receiver->timer.deadline;
+        host_timer_consume(&(receiver->timer));
+        switch (receiver->mode)
+        {
+            case HOST_RX_EDGE:
+                if (rx_edge_flush(&(receiver->rx_device), (uint32_t) self->now_us))
+                {
+                    host_timer_arm(&(receiver->timer), self->now_us,
+                                   RX_EDGE_FLUSH_BITS * receiver->rx_device.sync_rate, 0);
+                }
+                break;
+            case HOST_RX_PACKED:
+                host_rx_collect_sample(receiver, host_channel_sample(self));
+                break;
+            case HOST_RX_MULTI:
+                rx_multi_signal_callback(receiver->multi, host_channel_sample(self) ? receiver->multi_line_mask : 0);
+                break;
+            default:
+                rx_signal_callback(&(receiver->rx_device), host_channel_sample(self));
+                break;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+void host_link_run_until(rf_host_link* self, uint64_t end_us)
+{
+    while (1)
+    {
+        rf_host_transmitter* const transmitter = self->transmitter;
+        rf_host_receiver* const receiver = self->receiver;
+        uint64_t next = end_us;
+
+        if (transmitter && transmitter->timer.armed && transmitter->timer.deadline < next)
+        {
+            next = transmitter->timer.deadline;
+        }
+        if (receiver && receiver->timer.armed && receiver->timer.deadline < next)
+        {
+            next = receiver->timer.deadline;
+        }
+        if (next >= end_us || !host_link_step(self))
+        {
+            break;
+        }
+    }
+    if (self->now_us < end_us)
+    {
+        self->now_us = end_us;
+    }
+}
+
+void host_init_transmitter(rf_host_transmitter* self, rf_host_link* link, const RF_Config* config)
+{
+    memset(&(self->timer), 0, sizeof(rf_host_timer));
+    self->link = link;
+    self->trigger_count = 0;
+    self->runs = NULL;
+    self->run_count = 0;
+    self->run_index = 0;
+    link->transmitter = self;
+    self->timer.skew_ppm = link->channel ? link->channel->skew_ppm : 0;
+
+    tx_init(&(self->tx_device), host_tx_set_signal, host_tx_set_onetime_trigger_time,
+            host_tx_set_recurring_trigger_time, host_tx_cancel_trigger, host_tx_ready_callback, self, config);
+}
+
+int8_t host_tx_send_message(rf_host_transmitter* transmitter, RF_Message* message)
+{
+    return tx_send_message(&(transmitter->tx_device), message);
+}
+
+int8_t host_tx_send_bytes(rf_host_transmitter* transmitter, const uint8_t* data, uint8_t length)
+{
+    return tx_send_bytes(&(transmitter->tx_device), data, length);
+}
+
+int8_t host_tx_play_runs(rf_host_transmitter* transmitter, const TX_Run* runs, int16_t count)
+{
+    if (host_tx_is_busy(transmitter))
+    {
+        return -1;
+    }
+    transmitter->runs = runs;
+    transmitter->run_count = count;
+    transmitter->run_index = 0;
+    host_tx_play_next_run(transmitter);
+    return 0;
+}
+
+uint8_t host_tx_is_busy(rf_host_transmitter* transmitter)
+{
+    return transmitter->tx_device.state != TX_INITIAL || transmitter->tx_device.playing ||
+           transmitter->runs != NULL;
+}
+
+void host_init_receiver(rf_host_receiver* self, rf_host_link* link, void* result_callback, 
+                        const RF_Config* config)
+{
+    memset(&(self->timer), 0, sizeof(rf_host_timer));
+    self->link = link;
+    self->mode = HOST_RX_SAMPLED;
+    memset(self->samples, 0, sizeof(self->samples));
+    self->sample_count = 0;
+    self->multi = NULL;
+    self->multi_line_mask = 0;
+    rx_edge_sync_init(&(self->synchronizer), NULL, self);
+    link->receiver = self;
+
+    rx_init(&(self->rx_device), result_callback, host_rx_set_recurring_trigger_time,
+            host_rx_cancel_trigger, self, config);
+    rx_set_fractional_timing(&(self->rx_device), host_rx_set_trigger_period);
+}
+
+void host_rx_set_mode(rf_host_receiver* self, rf_host_rx_mode mode)
+{
+    self->mode = mode;
+}
+
+void host_rx_set_multi(rf_host_receiver* self, RX_Multi_Device* multi, uint32_t line_mask)
+{
+    rx_multi_init(multi, host_rx_set_recurring_trigger_time, host_rx_cancel_trigger, self,
+                  &(self->rx_device.config));
+    self->multi = multi;
+    self->multi_line_mask = line_mask;
+    self->mode = HOST_RX_MULTI;
+}
+
+void host_rx_start_receiving(rf_host_receiver* self)
+{
+    if (self->mode == HOST_RX_MULTI)
+    {
+        rx_multi_start_receiving(self->multi);
+    }
+    else if (self->mode == HOST_RX_EDGE)
+    {
+        rx_start_edge_receiving(&(self->rx_device));
+    }
+    else
+    {
+        if (self->mode == HOST_RX_EDGE_SYNC)
+        {
+            rx_set_external_synchronizer(&(self->rx_device), &(self->synchronizer.base));
+        }
+        rx_start_receiving(&(self->rx_device));
+    }
+}
+
+void host_rx_stop_receiving(rf_host_receiver* self)
+{
+    if (self->mode == HOST_RX_MULTI)
+    {
+        rx_multi_stop_receiving(self->multi);
+        return;
+    }
+    host_rx_flush_samples(self);
+    rx_edge_sync_stop(&(self->synchronizer));
+    rx_stop_receiving(&(self->rx_device));
+}
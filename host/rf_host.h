@@ -0,0 +1,253 @@
+/**
+ * @file rf_host.h
+ * @brief Header file for the host (Linux) platform port.
+ *
+ * The host port runs the TX and RX devices against a virtual clock instead of hardware timers.
+ * The transmitter's set_signal drives a simulated line that the receiver samples, so a full
+ * TX -> RX loopback runs at full CPU speed without any hardware.
+ */
+
+#ifndef RF_HOST_H
+#define RF_HOST_H
+
+#include <stdint.h>
+#include "rf_device.h"
+#include "rx_edge_synchronizer.h"
+#include "rx_multi_device.h"
+
+typedef struct rf_host_link rf_host_link;
+
+typedef struct
+{
+    uint64_t deadline;          // Absolute virtual time of the next trigger (us)
+    uint64_t period;            // 0 for a one-time trigger
+    uint8_t armed;
+    int32_t skew_ppm;           // Clock error of the device owning the timer
+    int64_t skew_residue;       // Fraction of a us carried over, in us / 1000000
+} rf_host_timer;
+
+/**
+ * Impairments of the simulated channel. All zero is an ideal channel.
+ */
+typedef struct
+{
+    double flip;                // Probability of a sample being inverted while the transmitter sends
+    double idle_flip;           // Probability of a sample being inverted while the transmitter is idle
+    double burst_rate;          // Probability of a noise burst starting on a sample
+    uint32_t burst_length;      // Samples of random level in a burst
+    uint32_t jitter_us;         // Every edge is delayed by 0 - jitter_us, uniformly
+    int32_t skew_ppm;           // Clock error of the transmitter, + runs slow
+} rf_host_channel_config;
+
+typedef struct
+{
+    uint32_t flip_threshold;        // Probabilities scaled to 2^32
+    uint32_t idle_flip_threshold;
+    uint32_t burst_threshold;
+    uint32_t burst_length;
+    uint32_t jitter_us;
+    int32_t skew_ppm;
+    uint64_t random_state;
+    uint32_t burst_left;            // Samples left in the current burst
+    uint64_t edge_time;             // When the latest edge reaches the receiver (us)
+    uint8_t previous_level;         // Level before the latest edge
+} rf_host_channel;
+
+typedef struct
+{
+    TX_Device tx_device;
+    rf_host_timer timer;
+    rf_host_link* link;
+    uint32_t trigger_count;     // Timer events handled, for comparing the scheduling modes
+    const TX_Run* runs;         // Compiled runs being played, NULL when the TX device drives the line
+    int16_t run_count;
+    int16_t run_index;
+} rf_host_transmitter;
+
+#define HOST_RX_PACKED_WORDS    1   // Samples are handed to rx_feed_samples 32 at a time
+
+typedef enum
+{
+    HOST_RX_SAMPLED = 0,        // Every sample through rx_signal_callback
+    HOST_RX_EDGE,               // Line edges through rx_edge_callback
+    HOST_RX_PACKED,             // Samples in blocks through rx_feed_samples
+    HOST_RX_EDGE_SYNC,          // Every sample, bit time detected by the edge synchronizer
+    HOST_RX_MULTI               // Every sample as a snapshot through rx_multi_signal_callback
+} rf_host_rx_mode;
+
+typedef struct
+{
+    RX_Device rx_device;
+    rf_host_timer timer;        // Sampling trigger, or the flush trigger in edge mode
+    rf_host_link* link;
+    rf_host_rx_mode mode;
+    uint32_t samples[HOST_RX_PACKED_WORDS];
+    uint16_t sample_count;
+    RX_Edge_Synchronizer synchronizer;
+    RX_Multi_Device* multi;     // HOST_RX_MULTI only
+    uint32_t multi_line_mask;   // Channels of the snapshot that see the line, the others stay low
+} rf_host_receiver;
+
+struct rf_host_link
+{
+    uint64_t now_us;            // Virtual clock
+    uint8_t line_level;         // Level currently driven by the transmitter
+    rf_host_transmitter* transmitter;
+    rf_host_receiver* receiver;
+    rf_host_channel* channel;   // NULL for an ideal channel
+};
+
+/**
+ * @brief Initializes the simulated link.
+ *
+ * The link owns the virtual clock and the line between one transmitter and one receiver.
+ *
+ * @param self Pointer to the link structure.
+ */
+void host_init_link(rf_host_link* self);
+
+/**
+ * @brief Initializes a channel model.
+ *
+ * The noise (flip, idle_flip, bursts) is applied to the samples the receiver takes in the
+ * sampled, packed and edgesync modes. The jitter moves the edges seen by all modes, and the skew
+ * scales the timers of the transmitter.
+ *
+ * @param self Pointer to the channel structure.
+ * @param config Impairments of the channel (copied).
+ * @param seed Seed of the noise, the same seed gives the same noise.
+ */
+void host_init_channel(rf_host_channel* self, const rf_host_channel_config* config, uint64_t seed);
+
+/**
+ * @brief Puts a channel model between the transmitter and the receiver of the link.
+ *
+ * @param self Pointer to the link structure.
+ * @param channel Pointer to the channel, or NULL for an ideal channel.
+ */
+void host_link_set_channel(rf_host_link* self, rf_host_channel* channel);
+
+/**
+ * @brief Processes the next pending timer event on the link.
+ *
+ * Advances the virtual clock to the earliest armed timer and fires it. On equal deadlines the
+ * transmitter fires first, so the receiver samples the level set at that instant.
+ *
+ * @param self Pointer to the link structure.
+ * @return 1 if an event was processed, 0 if no timer is armed.
+ */
+uint8_t host_link_step(rf_host_link* self);
+
+/**
+ * @brief Runs the link until the virtual clock reaches the given time or no timer is armed.
+ *
+ * @param self Pointer to the link structure.
+ * @param end_us Absolute virtual time to stop at (us).
+ */
+void host_link_run_until(rf_host_link* self, uint64_t end_us);
+
+/**
+ * @brief Initializes the host transmitter and attaches it to the link.
+ *
+ * @param self Pointer to the host transmitter structure.
+ * @param link Pointer to the link the transmitter drives.
+ * @param config Link timing, or NULL for RF_CONFIG_DEFAULT.
+ */
+void host_init_transmitter(rf_host_transmitter* self, rf_host_link* link, const RF_Config* config);
+
+/**
+ * @brief Sends a message using the host transmitter.
+ *
+ * @param transmitter The host transmitter.
+ * @param message The message to be sent.
+ * @return Returns 0 if the message is accepted, otherwise returns -1.
+ */
+int8_t host_tx_send_message(rf_host_transmitter* transmitter, RF_Message* message);
+
+/**
+ * @brief Sends a byte frame using the host transmitter.
+ *
+ * @param transmitter The host transmitter.
+ * @param data Payload bytes, must stay valid until the frame is sent.
+ * @param length Number of payload bytes.
+ * @return Returns 0 if the frame is accepted, otherwise returns -1.
+ */
+int8_t host_tx_send_bytes(rf_host_transmitter* transmitter, const uint8_t* data, uint8_t length);
+
+/**
+ * @brief Plays runs compiled with tx_compile_runs onto the line, like a DMA or PIO engine would.
+ *
+ * The line is set at the start of each run and a one-time trigger is armed for its duration.
+ * The line is low after the last run. The TX device is not called while the runs are played.
+ *
+ * @param transmitter The host transmitter.
+ * @param runs The runs, must stay valid until they are played.
+ * @param count Number of runs.
+ * @return Returns 0 if the runs are started, -1 if the transmitter is busy.
+ */
+int8_t host_tx_play_runs(rf_host_transmitter* transmitter, const TX_Run* runs, int16_t count);
+
+/**
+ * @brief Checks if the host transmitter is still sending.
+ *
+ * @param transmitter The host transmitter.
+ * @return 1 if a message is being sent, 0 otherwise.
+ */
+uint8_t host_tx_is_busy(rf_host_transmitter* transmitter);
+
+/**
+ * @brief Initializes the host receiver and attaches it to the link.
+ *
+ * The receiver uses the static synchronization of the RX device.
+ *
+ * @param self Pointer to the host receiver structure.
+ * @param link Pointer to the link the receiver samples.
+ * @param result_callback Pointer to the callback function for receiving results.
+ * @param config Link timing, or NULL for RF_CONFIG_DEFAULT.
+ */
+void host_init_receiver(rf_host_receiver* self, rf_host_link* link, void* result_callback, 
+                        const RF_Config* config);
+
+/**
+ * @brief Selects how the host receiver delivers the line to the RX device.
+ *
+ * In HOST_RX_EDGE mode every level change on the line is delivered to rx_edge_callback with the
+ * virtual time. In HOST_RX_PACKED mode the samples are collected into words and fed to
+ * rx_feed_samples. In HOST_RX_EDGE_SYNC mode the line edges go to the edge synchronizer, which
+ * detects the bit time from the sync symbol, and the samples to rx_signal_callback. Call before
+ * host_rx_start_receiving.
+ *
+ * @param self Pointer to the host receiver structure.
+ * @param mode The receive mode.
+ */
+void host_rx_set_mode(rf_host_receiver* self, rf_host_rx_mode mode);
+
+/**
+ * @brief Makes the host receiver feed a multi-channel RX device instead of its own RX device.
+ *
+ * Initializes the multi-channel device with the timing of the receiver and selects the
+ * HOST_RX_MULTI mode. Every sample is given to rx_multi_signal_callback as a snapshot where the
+ * channels in line_mask have the level of the line and the others are low. Add the channels with
+ * rx_multi_add_channel before host_rx_start_receiving.
+ *
+ * @param self Pointer to the host receiver structure.
+ * @param multi Pointer to the multi-channel RX device, owned by the caller.
+ * @param line_mask Channels connected to the line.
+ */
+void host_rx_set_multi(rf_host_receiver* self, RX_Multi_Device* multi, uint32_t line_mask);
+
+/**
+ * @brief Starts receiving data using the host receiver.
+ *
+ * @param self Pointer to the host receiver structure.
+ */
+void host_rx_start_receiving(rf_host_receiver* self);
+
+/**
+ * @brief Stops receiving data using the host receiver.
+ *
+ * @param self Pointer to the host receiver structure.
+ */
+void host_rx_stop_receiving(rf_host_receiver* self);
+
+#endif // RF_HOST_H
@@ -1,90 +1,34 @@
 /**
  * @file debug_logging.h
- * @brief Header file for debug logging functionality.
+ * @brief Header file for debug tracing functionality.
  */
 #ifndef DEBUG_LOGGING_H
 #define DEBUG_LOGGING_H
 
-//#define ENABLE_LOGGING
+#include "rf_trace.h"
 
-#ifdef ENABLE_LOGGING
-#include <stdio.h>
-#include <stdlib.h>
-#include "pico/stdlib.h"
+//#define ENABLE_TRACING
 
+#ifdef ENABLE_TRACING
 /**
  * @def TRACE
- * @brief Macro for printing debug log messages.
- * @param fmt The format string for the log message.
- * @param ... The optional arguments to be formatted and printed.
+ * @brief Macro for recording a trace event.
+ * @param event The event id (RF_Trace_Event).
+ * @param arg The 16-bit argument of the event.
  *
- * This macro is used to print debug log messages when logging is enabled.
- * It prints the log message along with the function name and line number.
+ * Records a binary event into the ring given to rf_trace_init. Safe in interrupt handlers,
+ * nothing is formatted or printed here.
  */
-#define TRACE(fmt, ...) \
-    do { \
-        printf("[%s:%d] " fmt "\n", __func__, __LINE__, ##__VA_ARGS__); \
-    } while (0)
-
-#define INITLOG(max_log_size) log_initlog(max_log_size);
-#define LOGENTRY(signal, custom) log_logentry(signal, custom);
-#define PRINTLOG log_printlog();
-
-typedef struct Logging_data
-{
-    uint64_t    timestamp;
-    int8_t      signal;
-    uint16_t     custom;
-}Logging_data;
-
-static uint16_t logindex;
-static Logging_data* logger_data;
-
-static void log_logentry(int8_t signal, uint16_t custom)
-{
-    logger_data[logindex].timestamp = to_us_since_boot(get_absolute_time());
-    logger_data[logindex].signal = signal;
-    logger_data[logindex].custom = custom;
-    logindex++;
-}
-
-static void log_printlog()
-{
-    int i;
-    for (i = 0; i < logindex; i++)
-    {
-        printf("t:%llu,s:%d,c:%u ",logger_data[i].timestamp,logger_data[i].signal,logger_data[i].custom);
-        if (i != 0 && i % 5 == 0)
-        {
-            printf("\n");
-        }
-
-    }
-    if (i != 0 && i % 5 != 0)
-    {
-        printf("\n");
-    }
-
-}
-
-static void log_initlog(uint16_t max_log_size)
-{
-    logger_data = (Logging_data*) malloc (sizeof(Logging_data)* max_log_size);
-    logindex = 0;
-}
+#define TRACE(event, arg) rf_trace((event), (uint16_t) (arg))
 
 #else
 /**
  * @def TRACE
- * @brief Empty macro when logging is disabled.
+ * @brief Empty macro when tracing is disabled.
  *
- * This macro is empty when logging is disabled, allowing for easy removal
- * of debug log statements from the code.
+ * This macro is empty when tracing is disabled, allowing for easy removal
+ * of trace points from the code.
  */
-#define TRACE(fmt, ...) do {} while (0)
-
-#define INITLOG(max_log_size) log_initlog(max_log_size);
-#define LOGENTRY(signal, customer) log_logentry(signal, customer);
-#define PRINTLOG log_printlog();
+#define TRACE(event, arg) do {} while (0)
+#endif
 #endif
-#endif
\ No newline at end of file
@@ -0,0 +1,180 @@
+/**
+ * @file rf_capture.h
+ * @brief Header file for the raw input capture of the RX device.
+ *
+ * A capture records what the RX device was fed, so a reception can be replayed offline bit for
+ * bit (see host-rf-replay). Sample captures hold the signal_status stream of rx_signal_callback
+ * and rx_feed_samples as runs of equal samples. Edge captures hold the calls of rx_edge_callback
+ * and rx_edge_flush with their timestamps. Either way an idle line takes a few bytes per bit
+ * change, not per sample.
+ *
+ * Format: a header of RF_CAPTURE_HEADER_SIZE bytes, then one varint (LEB128) per record.
+ *  - Header: "PRFC", version, kind, line coding, flags, bit_time (LE16), wakeup_time (LE16),
+ *    sampling_count, sampling_tolerance, sync_symbol_length, frame_gap, sync_tolerance, 3 x 0.
+ *  - Sample record: run_length << 1 | level. Runs of 2^32 samples or more are split.
+ *  - Edge record: delta << 2 | flush << 1 | level, delta in us from the previous record (from 0
+ *    for the first one). A flush record has level 0.
+ *
+ * Writing costs a compare per sample and a few stores per record, so it can be left on in the
+ * interrupt handler. The buffer is owned by the caller. When it fills up it is handed to the
+ * flush function, or without one the recording stops so the capture stays a clean prefix.
+ */
+
+#ifndef RF_CAPTURE_H
+#define RF_CAPTURE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "rf_device.h"
+
+#define RF_CAPTURE_VERSION          1
+#define RF_CAPTURE_HEADER_SIZE      20
+#define RF_CAPTURE_MAX_RECORD       5       // Bytes of the longest varint record
+#define RF_CAPTURE_PHASE_TRACKING   0x01    // Header flag: rx_set_phase_tracking was enabled
+#define RF_CAPTURE_CRC_REPAIR       0x02    // Header flag: rx_set_crc_repair was enabled
+
+typedef enum
+{
+    RF_CAPTURE_SAMPLES = 0,             // rx_signal_callback / rx_feed_samples
+    RF_CAPTURE_EDGES                    // rx_edge_callback / rx_edge_flush
+} RF_Capture_Kind;
+
+typedef enum
+{
+    RF_CAPTURE_RUN = 0,                 // Samples: value samples at level
+    RF_CAPTURE_EDGE,                    // Edges: rx_edge_callback at value with level
+    RF_CAPTURE_FLUSH                    // Edges: rx_edge_flush at value
+} RF_Capture_Record_Type;
+
+struct RF_Capture
+{
+    uint8_t*    buffer;
+    size_t      size;
+    size_t      length;                 // Bytes in the buffer
+    uint8_t     kind;                   // RF_Capture_Kind
+    uint8_t     full;                   // Buffer filled up without a flush function, recording stopped
+    uint32_t    dropped_count;          // Records not written because the buffer was full
+
+    uint8_t     level;                  // Samples: level of the current run
+    uint32_t    run_length;             // Samples: samples in the current run, 0 before the first sample
+    uint32_t    last_timestamp;         // Edges: timestamp of the previous record
+
+    void (*flush)(const uint8_t* /*data*/, size_t /*length*/, void* /*user_data*/);
+    void* user_data;
+};
+
+typedef struct
+{
+    uint8_t     kind;                   // RF_Capture_Kind
+    uint8_t     line_coding;            // RF_Line_Coding
+    uint8_t     flags;                  // RF_CAPTURE_PHASE_TRACKING, RF_CAPTURE_CRC_REPAIR
+    RF_Config   config;
+} RF_Capture_Header;
+
+typedef struct
+{
+    uint8_t     type;                   // RF_Capture_Record_Type
+    uint8_t     level;
+    uint32_t    value;                  // Run length in samples, or timestamp in us
+} RF_Capture_Record;
+
+typedef struct
+{
+    const uint8_t*  data;
+    size_t      length;
+    size_t      position;
+    RF_Capture_Header header;
+    uint32_t    timestamp;              // Edges: timestamp of the previous record
+} RF_Capture_Reader;
+
+/**
+ * @brief Initializes a capture.
+ *
+ * Attach it to an RX device with rx_set_capture, which writes the header.
+ *
+ * @param self Pointer to the capture structure.
+ * @param kind RF_CAPTURE_SAMPLES or RF_CAPTURE_EDGES, matching how the RX device is fed.
+ * @param buffer Buffer for the capture, owned by the caller.
+ * @param size Size of the buffer, at least RF_CAPTURE_HEADER_SIZE + RF_CAPTURE_MAX_RECORD.
+ * @param flush Pointer to the function taking a full buffer, or NULL to stop when full.
+ *              Called from the interrupt handler, the data must be copied or handed over
+ *              before it returns.
+ * @param user_data User-defined data pointer for flush.
+ */
+void rf_capture_init(RF_Capture* self, RF_Capture_Kind kind, uint8_t* buffer, size_t size,
+                     void* flush, void* user_data);
+
+/**
+ * @brief Writes the header of a capture.
+ *
+ * @param self Pointer to the capture structure.
+ * @param config Link timing of the RX device.
+ * @param coding Line coding of the RX device.
+ * @param flags RF_CAPTURE_PHASE_TRACKING, RF_CAPTURE_CRC_REPAIR or 0.
+ */
+void rf_capture_begin(RF_Capture* self, const RF_Config* config, RF_Line_Coding coding, uint8_t flags);
+
+/**
+ * @brief Records one sample.
+ *
+ * @param self Pointer to the capture structure.
+ * @param level The sample (0 or 1).
+ */
+void rf_capture_sample(RF_Capture* self, uint8_t level);
+
+/**
+ * @brief Records a block of packed samples, as given to rx_feed_samples.
+ *
+ * @param self Pointer to the capture structure.
+ * @param packed Samples packed 32 per word, LSB first.
+ * @param nbits Number of samples in the block.
+ */
+void rf_capture_packed(RF_Capture* self, const uint32_t* packed, size_t nbits);
+
+/**
+ * @brief Records a call of rx_edge_callback.
+ *
+ * @param self Pointer to the capture structure.
+ * @param timestamp_us Timestamp of the edge in microseconds.
+ * @param level Level of the signal after the edge.
+ */
+void rf_capture_edge(RF_Capture* self, uint32_t timestamp_us, uint8_t level);
+
+/**
+ * @brief Records a call of rx_edge_flush.
+ *
+ * @param self Pointer to the capture structure.
+ * @param timestamp_us Time of the flush in microseconds.
+ */
+void rf_capture_edge_flush(RF_Capture* self, uint32_t timestamp_us);
+
+/**
+ * @brief Ends a capture.
+ *
+ * Writes the sample run in progress and hands the rest of the buffer to the flush function.
+ * Without a flush function the capture is buffer[0 .. length - 1].
+ *
+ * @param self Pointer to the capture structure.
+ */
+void rf_capture_finish(RF_Capture* self);
+
+/**
+ * @brief Opens a capture for reading.
+ *
+ * @param self Pointer to the reader structure.
+ * @param data The whole capture, header included.
+ * @param length Length of the capture in bytes.
+ * @return 0 if the header is valid, -1 otherwise.
+ */
+int8_t rf_capture_open(RF_Capture_Reader* self, const uint8_t* data, size_t length);
+
+/**
+ * @brief Reads the next record of a capture.
+ *
+ * @param self Pointer to the reader structure.
+ * @param record The record is written here.
+ * @return 1 if a record was read, 0 at the end of the capture or on a truncated record.
+ */
+uint8_t rf_capture_read(RF_Capture_Reader* self, RF_Capture_Record* record);
+
+#endif // RF_CAPTURE_H
@@ -7,11 +7,20 @@
 #define RFDEVICE_H
 
 #include <stdint.h>
+#include <stddef.h>
+
+// Times the interrupt handlers into stats.isr with the timestamp hooks. Must be the same for the
+// library and its users, so define it for the whole build, not here.
+//#define ENABLE_ISR_STATS
 
 #define MAX_PAYLOAD_LENGTH          64
 #define PAYLOAD_LENGTH              7
 
+#define MAX_PAYLOAD_BYTES           255    // Byte frames
+#define PAYLOAD_BYTE_LENGTH         8
+
 #define START_SYMBOL                0xA39   
+#define START_SYMBOL_BYTES          0xAC6  // Start symbol of a byte frame
 #define START_SYMBOL_LENGTH         12
 #define START_SYMBOL_MASK           0xFFF
 
@@ -21,18 +30,90 @@
 #define TX_FREQUENCY                1000   // us / bit
 #define SAMPLING_COUNT              10     // number of samples per bit (even). Speed = sampling_frequency / sampling_count
 #define SAMPLING_TOLERANCE          2      // number of wrong samples that can be tolerated
+#define SYNC_TOLERANCE              2      // number of wrong samples tolerated in the static sync pattern
+#define TX_WAKEUP_TIME              500    // us, length of both halves of the wake-up pulse
+#define MAX_SAMPLING_COUNT          16     // upper limit of RF_Config.sampling_count
+#define RF_MIN_SAMPLING_COUNT       4      // lower limit of RF_Config.sampling_count
+#define RF_MIN_SYNC_SYMBOL_LENGTH   4      // lower limit of RF_Config.sync_symbol_length
+#define TX_FRAME_GAP                4      // bits of low line between back-to-back frames
+#ifndef TX_QUEUE_LENGTH
+#define TX_QUEUE_LENGTH             4      // frames waiting behind the one being sent (power of two)
+#endif
+// Upper limit of runs for one message with any line coding: wake-up, sync, start and the coded fields
+#define TX_MAX_MESSAGE_RUNS         (2 + SYNC_SYMBOL_LENGTH + START_SYMBOL_LENGTH + \
+                                     (((PAYLOAD_LENGTH + 3) / 4) + (MAX_PAYLOAD_LENGTH / 4) + 4) * 7)
+
+#define RX_SYNC_PATTERN_BITS        4      // bits covered by the static sync pattern
+#define RX_EDGE_FLUSH_BITS          4      // idle bits after the last edge before the edge receiver flushes
+#define RX_PERIOD_FRACTION_BITS     16     // fixed point of the RX sample period
+#define RX_SYNC_NO_CANDIDATE        0xFF   // no sync window within sync_tolerance yet
+#define RX_REPAIR_BITS              3      // least confident bits tried by the CRC repair, 2^n - 1 candidates
+#define RF_STATS_HISTOGRAM_BINS     12     // ISR durations, bin n counts 2^(n-1) .. 2^n - 1 ticks, the last one the rest
 
 typedef struct RX_Synchronizer RX_Synchronizer;
 typedef struct RX_Device RX_Device;
 typedef struct TX_Device TX_Device;
+typedef struct RF_Capture RF_Capture;
+
+typedef enum
+{
+    RF_LINE_CODING_NRZ = 0,     // Bits as such
+    RF_LINE_CODING_4B6B,        // Each nibble as a DC-balanced 6-bit symbol, RH_ASK symbol table
+    RF_LINE_CODING_HAMMING74    // Each nibble as a Hamming(7,4) codeword, corrects a wrong bit per codeword
+} RF_Line_Coding;
+
+/**
+ * Per-device link timing, overriding the compile-time defaults above. The transmitter and the
+ * receiver of a link must agree on bit_time (unless an external synchronizer detects it).
+ * rx_init and tx_init clamp the values to the ranges below with rf_config_clamp.
+ */
+typedef struct
+{
+    uint16_t    bit_time;               // us / bit, a multiple of sampling_count unless the RX uses fractional timing
+    uint8_t     sampling_count;         // number of samples per bit (even, 4 - MAX_SAMPLING_COUNT)
+    uint8_t     sampling_tolerance;     // number of wrong samples that can be tolerated, < (sampling_count - 2) / 2
+                                        // (the default of SAMPLING_COUNT 10 is lowered for fewer samples)
+    uint8_t     sync_symbol_length;     // number of sync bits sent (even, 4 - SYNC_SYMBOL_LENGTH)
+    uint16_t    wakeup_time;            // us
+    uint8_t     frame_gap;              // bits between back-to-back frames (0 - sync_symbol_length)
+    uint8_t     sync_tolerance;         // wrong samples tolerated in the static sync pattern (0 = exact match)
+} RF_Config;
+
+#define RF_CONFIG_DEFAULT   { TX_FREQUENCY, SAMPLING_COUNT, SAMPLING_TOLERANCE, SYNC_SYMBOL_LENGTH, TX_WAKEUP_TIME, \
+                              TX_FRAME_GAP, SYNC_TOLERANCE }
+
+/**
+ * Quality of a received frame, from the sample majorities (margins) of its bits after the start
+ * symbol. Bit front ends without samples give every bit the full margin.
+ */
+typedef struct
+{
+    uint8_t     score;                  // Mean margin, 255 when all samples of every bit agreed
+    uint8_t     weakest_margin;         // Smallest margin of a bit, in samples (0 - sampling_count - 2)
+    uint8_t     repaired_bits;          // Bits flipped by the CRC repair
+} RF_Link_Quality;
 
 typedef struct
 {
     uint64_t    message;           
     uint8_t     message_length;    
     uint16_t    message_crc;       
+    RF_Link_Quality quality;            // Set by the receiver, not used by the transmitter
 } RF_Message;
 
+#define RF_CRC16_POLYNOMIAL     0x1021  // CCITT
+#define RF_CRC16_INITIAL        0xFFFF
+
+/**
+ * Incremental CRC-16, updated as the bits of a frame are sent or received.
+ */
+typedef struct
+{
+    uint16_t    crc;                // CRC of the whole nibbles so far
+    uint8_t     pending;            // Bits not yet added, at most 3
+    uint8_t     pending_count;
+} RF_CRC16;
+
 typedef enum
 {
     TX_INITIAL = 0,
@@ -41,17 +122,65 @@ typedef enum
     TX_SEND_START,          
     TX_SEND_LENGTH,         
     TX_SEND_PAYLOAD,        
-    TX_SEND_CRC             
+    TX_SEND_BYTES,
+    TX_SEND_CRC,
+    TX_FRAME_GAP_WAIT
 }TX_State;
 
+typedef struct
+{
+    uint32_t    duration;               // us
+    uint8_t     level;
+} TX_Run;
+
+typedef struct
+{
+    RF_Message      message;
+    const uint8_t*  payload;            // Byte frame payload, NULL for a message
+    uint8_t         payload_length;
+} TX_Frame;
+
+// Duration of the interrupt handler, in ticks of the timestamp hook
+typedef struct
+{
+    uint32_t    count;
+    uint32_t    min;
+    uint32_t    max;
+    uint64_t    total;                  // Sum of the durations, for the mean
+    uint32_t    histogram[RF_STATS_HISTOGRAM_BINS];
+} RF_ISR_Stats;
+
+typedef struct
+{
+    uint32_t    frames_queued;
+    uint32_t    frames_sent;            // Frames whose CRC was put on the line
+    uint32_t    queue_full_count;       // Frames rejected because the queue was full
+#ifdef ENABLE_ISR_STATS
+    RF_ISR_Stats isr;                   // tx_callback, with a timestamp hook only
+#endif
+} TX_Stats;
+
 typedef struct 
 {
     uint8_t low_sample_count; 
     uint8_t high_sample_count; 
     uint8_t sync_index;     
     uint8_t latest_bit;     
+    uint8_t confidence;             // Margin of the samples of latest_bit (|high - low|), 0 for a guess
 } RX_Bit;
 
+typedef struct
+{
+    uint16_t    index;                  // Line bit of the frame, from the first length bit
+    uint8_t     margin;
+} RX_Weak_Bit;
+
+typedef struct
+{
+    uint32_t    key;                    // Hash of the frame, 0 for a free slot
+    uint32_t    time;                   // Time of the first copy, in ticks of the dedup clock
+} RX_Dedup_Entry;
+
 typedef enum 
 {
     RX_SYNC = 0,
@@ -59,29 +188,119 @@ typedef enum
     RX_WAIT_START,          
     RX_READ_LENGTH,         
     RX_READ_PAYLOAD,        
+    RX_READ_BYTES,
     RX_READ_CRC             
 }RX_State;
 
+#define RX_STATE_COUNT              (RX_READ_CRC + 1)
+
+// Why the receiver went back to sync from a frame
+typedef enum
+{
+    RX_LOSS_SAMPLE = 0,                 // Too few equal samples in a bit, or a run shorter than half a bit
+    RX_LOSS_NO_START,                   // No start symbol after the sync
+    RX_LOSS_END_OF_TRAIN,               // No start symbol after a received frame, the normal end of a train
+    RX_LOSS_LENGTH,                     // Invalid length field
+    RX_LOSS_SYMBOL,                     // Invalid 4b6b symbol
+    RX_LOSS_CRC,                        // CRC mismatch, the frame was dropped
+    RX_LOSS_FILTERED,                   // Message rejected by the message filter, the frame was dropped
+    RX_LOSS_COUNT
+} RX_Sync_Loss;
+
+typedef struct
+{
+    uint32_t    sync_count;             // Syncs found
+    uint32_t    frames_received;        // Frames delivered to the application
+    uint32_t    sync_losses[RX_LOSS_COUNT];
+    uint32_t    state_samples[RX_STATE_COUNT];  // Samples spent in each state (bits * sampling_count for bit front ends)
+    uint32_t    corrected_bits;         // Line bits corrected by RF_LINE_CODING_HAMMING74
+    uint32_t    repaired_frames;        // Frames delivered after the CRC repair
+    uint32_t    duplicate_frames;       // Frames dropped by the dedup filter, not in frames_received
+#ifdef ENABLE_ISR_STATS
+    RF_ISR_Stats isr;                   // rx_signal_callback, rx_feed_samples and the edge callbacks, with a timestamp hook only
+#endif
+} RX_Stats;
+
 struct RX_Device
 {
+    RF_Config   config;
     RX_State    state; 
     RX_Bit      rx_bit; 
     RF_Message  message; 
+    RF_CRC16    crc;                    // CRC of the frame so far
+
+    uint32_t    margin_sum;             // Frame so far: sum of the bit margins
+    uint16_t    frame_bit_count;        // Frame so far: line bits from the length field on
+    uint8_t     weakest_margin;
+    RX_Weak_Bit weak_bits[RX_REPAIR_BITS];  // Least confident payload and CRC bits, weakest first
+    uint8_t     weak_bit_count;
+    uint8_t     crc_repair;             // Try flipping weak_bits when the CRC does not match
 
     uint8_t     signal_state; 
     uint64_t    buffer; 
     uint8_t     buffer_current_bit_index; 
+    uint8_t     start_timeout;          // Bits to wait for the start symbol in RX_WAIT_START
 
     uint64_t    sync_pattern;
     uint64_t    sync_pattern_mask; 
+    uint8_t     sync_best_distance;     // Static sync: fewest wrong samples seen in the window, RX_SYNC_NO_CANDIDATE if none
+    uint8_t     sync_best_age;          // Static sync: samples since that alignment
+    uint8_t     frame_done;             // A frame was received since the latest sync
     
-    uint16_t sync_rate;
+    uint16_t sync_rate;                 // Bit time in us, detected or config.bit_time
+    uint32_t    sample_period;          // us / sample, RX_PERIOD_FRACTION_BITS fixed point
+    uint32_t    sample_phase;           // Fraction of a us carried over to the next sample
+    uint32_t    trigger_period;         // Whole us the recurring trigger runs at
+    uint8_t     phase_tracking;         // Move the sampling window toward the observed transitions
     RX_Synchronizer* ext_synchronizer;
 
+    uint32_t    last_edge_timestamp;    // Edge receiver: start of the current run (us)
+    uint8_t     edge_seen;              // Edge receiver: last_edge_timestamp is valid
+    uint8_t     edge_glitch;            // Edge receiver: a run shorter than half a bit was absorbed
+
+    RF_Line_Coding line_coding;         // Coding of the fields after the start symbol
+    uint8_t     symbol;                 // 4b6b / Hamming: line bits of the current symbol
+    uint8_t     symbol_bit_count;
+    uint8_t     symbol_confidence[7];   // Hamming: confidence of each line bit, first bit first
+    uint8_t     pad_bit_count;          // 4b6b / Hamming: leading bits to drop to align the field to nibbles
+    void (*field_function)(RX_Device* /*self*/);   // 4b6b / Hamming: state function the decoded bits go to
+
+    uint8_t*    byte_buffer;            // Byte frames are received here, NULL if not enabled
+    uint8_t     byte_buffer_size;
+    uint8_t     byte_frame;             // Current frame is a byte frame
+    uint8_t     byte_length;
+    uint8_t     byte_index;
+    void (*bytes_callback) (const uint8_t* /*data*/, uint8_t /*length*/, uint16_t /*crc*/);
+
+    RF_Message* message_queue;          // Ring of received messages, NULL to use result_callback
+    uint8_t     message_queue_mask;     // Size of the ring - 1
+    uint8_t     message_queue_head;     // Written by the receiver only (free running)
+    uint8_t     message_queue_tail;     // Written by rx_poll_message only (free running)
+    uint32_t    message_queue_overflow_count;  // Messages dropped because the ring was full
+
+    RX_Dedup_Entry* dedup_table;        // Recently delivered frames, NULL to deliver every copy
+    uint8_t     dedup_mask;             // Size of the table - 1
+    uint32_t    dedup_window;           // Copies within this many clock ticks are dropped
+    uint64_t    dedup_key_mask;         // Message bits the key is made of, 0 for the whole frame and CRC
+    uint32_t (*get_dedup_time)(void* /*user_data*/);
+
+    uint64_t    filter_mask;            // Message bits checked by the message filter, 0 to accept all
+    uint64_t    filter_value;
+    uint8_t     filter_shift;           // Lowest bit of filter_mask, arrives last
+    uint8_t     filter_length;          // Shortest message holding every bit of filter_mask, 0 without a filter
+    uint8_t     filter_bit_index;       // Current frame: payload bit after which the filter is checked
+
     void (*state_function)(RX_Device* /*self*/); 
     void (*result_callback) (RF_Message* /*message*/); 
     void (*set_recurring_trigger_time)(uint64_t /*time_to_trigger*/, void* /*trigger_user_data*/); 
     void (*cancel_trigger)(void* /*trigger_user_data*/); 
+    void (*set_trigger_period)(uint32_t /*period*/, void* /*trigger_user_data*/);  // NULL without fractional timing
+
+    RX_Stats    stats;
+#ifdef ENABLE_ISR_STATS
+    uint32_t (*get_timestamp)(void* /*user_data*/);     // NULL to skip the ISR timing
+#endif
+    RF_Capture* capture;                // Records the input, NULL if not recording
     void* user_data; 
 };
 
@@ -92,16 +311,41 @@ struct RX_Synchronizer
 
 struct TX_Device
 {
+    RF_Config   config;
     TX_State    state; 
     RF_Message  message; 
+    RF_CRC16    crc;                    // CRC of the fields sent so far
     uint8_t     step_index; 
 
+    const uint8_t* payload;             // Byte frame payload, owned by the caller
+    uint8_t     payload_length;
+    uint8_t     byte_index;
+    uint8_t     byte_mode;              // Current frame is a byte frame
+    RF_Line_Coding line_coding;         // Coding of the fields after the start symbol
+
+    TX_Frame    queue[TX_QUEUE_LENGTH]; // Frames to send after the current one
+    uint8_t     queue_head;             // Written by tx_send_message / tx_send_bytes only (free running)
+    uint8_t     queue_tail;             // Written by the transmitter only (free running)
+
+    uint8_t     edge_scheduled;         // One one-shot trigger per level change instead of one per bit
+    uint8_t     manual_start;           // Frames are only queued, until tx_start_sending or tx_compile_runs
+    uint8_t     playing;                // Edge scheduling: a train is on the line
+    uint8_t     step_level;             // Edge scheduling: level and duration of the latest bit step
+    uint32_t    step_time;
+    TX_Run      pending;                // Edge scheduling: first step of the next run
+    uint8_t     pending_valid;
+
     void (*state_function)(TX_Device* /*self*/); 
     void (*set_signal)(uint8_t /*is_high*/, void* /*user_data*/); 
     void (*set_onetime_trigger_time)(uint64_t /*time_to_trigger*/, void* /*trigger_user_data*/); 
     void (*set_recurring_trigger_time)(uint64_t /*time_to_trigger*/, void* /*trigger_user_data*/); 
     void (*cancel_trigger)(void* /*trigger_user_data*/); 
     void (*tx_ready)(void* /*trigger_user_data*/);
+
+    TX_Stats    stats;
+#ifdef ENABLE_ISR_STATS
+    uint32_t (*get_timestamp)(void* /*user_data*/);     // NULL to skip the ISR timing
+#endif
     void* user_data; 
 };
 
@@ -116,20 +360,130 @@ struct TX_Device
  * @param set_recurring_trigger_time Pointer to the function for setting a recurring trigger time.
  * @param cancel_trigger Pointer to the function for canceling the trigger.
  * @param user_data User-defined data pointer.
+ * @param config Link timing of the device (copied), or NULL for RF_CONFIG_DEFAULT.
  */
 void tx_init(TX_Device* self, void (*set_signal), void (*set_onetime_trigger_time), 
                 void (*set_recurring_trigger_time), void (*cancel_trigger), 
-                void (*tx_ready_callback), void* user_data);
+                void (*tx_ready_callback), void* user_data, const RF_Config* config);
 
 /**
  * @brief Sends a message using the TX device.
  *
+ * The CRC field is computed while sending (see rf_crc16_message), message_crc is not used.
+ * If a frame is being sent, the message is queued. Queued frames follow the current one
+ * back to back: only config.frame_gap low bits and the start symbol are sent between them,
+ * so the receiver stays locked over the whole train. tx_ready is called when the queue is empty.
+ * With tx_set_manual_start the message is always queued.
+ *
  * @param self Pointer to the TX device structure.
  * @param message The message to be sent.
- * @return Returns 0 if the message is successfully sent, otherwise returns -1.
+ * @return Returns 0 if the message is sent or queued, -1 if the queue is full.
  */
 int8_t tx_send_message(TX_Device* self, RF_Message* message);
 
+/**
+ * @brief Sends a byte frame using the TX device.
+ *
+ * A byte frame carries up to MAX_PAYLOAD_BYTES bytes, each sent MSB first starting from data[0].
+ * The data is not copied, it must stay valid until the tx_ready callback. Queued as tx_send_message.
+ *
+ * @param self Pointer to the TX device structure.
+ * @param data Payload bytes.
+ * @param length Number of payload bytes (1 - MAX_PAYLOAD_BYTES).
+ * @return Returns 0 if the frame is sent or queued, otherwise returns -1.
+ */
+int8_t tx_send_bytes(TX_Device* self, const uint8_t* data, uint8_t length);
+
+/**
+ * @brief Sets the line coding of the TX device.
+ *
+ * With RF_LINE_CODING_4B6B the length, payload and CRC are sent as DC-balanced 6-bit symbols,
+ * one per nibble, with fields padded with leading zeros to whole nibbles. The sync and start
+ * symbols are sent as such. RF_LINE_CODING_HAMMING74 sends each nibble as a 7-bit Hamming
+ * codeword instead, for forward error correction. The receiver must use the same coding.
+ *
+ * @param self Pointer to the TX device structure.
+ * @param coding The line coding.
+ */
+void tx_set_line_coding(TX_Device* self, RF_Line_Coding coding);
+
+/**
+ * @brief Enables edge scheduling of the TX device.
+ *
+ * The frame is turned into runs of (level, duration) and the line is set once per run, with one
+ * set_onetime_trigger_time per level change instead of a trigger on every bit. The recurring
+ * trigger is not used. Call while the device is idle.
+ *
+ * @param self Pointer to the TX device structure.
+ * @param enabled 1 to enable, 0 to set the line on every bit.
+ */
+void tx_set_edge_scheduling(TX_Device* self, uint8_t enabled);
+
+/**
+ * @brief Enables the manual start of the TX device.
+ *
+ * tx_send_message and tx_send_bytes only queue the frames, up to TX_QUEUE_LENGTH of them, also
+ * when the device is idle. They are sent as one train by tx_start_sending, or compiled into runs
+ * by tx_compile_runs.
+ *
+ * @param self Pointer to the TX device structure.
+ * @param enabled 1 to only queue, 0 to start sending on the first frame queued.
+ */
+void tx_set_manual_start(TX_Device* self, uint8_t enabled);
+
+/**
+ * @brief Starts sending the queued frames, if the device is idle.
+ *
+ * Only needed with tx_set_manual_start, otherwise the first frame queued starts the transmitter.
+ *
+ * @param self Pointer to the TX device structure.
+ */
+void tx_start_sending(TX_Device* self);
+
+/**
+ * @brief Sets the timestamp hook for measuring the interrupt handler.
+ *
+ * With a hook, every tx_callback is timed into stats.isr. The tick is whatever the hook counts,
+ * e.g. us on the Pico. Does nothing unless ENABLE_ISR_STATS is defined.
+ *
+ * @param self Pointer to the TX device structure.
+ * @param get_timestamp Pointer to the function returning the current time, or NULL to stop timing.
+ */
+void tx_set_timestamp_hook(TX_Device* self, void* get_timestamp);
+
+/**
+ * @brief Clears the statistics of the TX device.
+ *
+ * @param self Pointer to the TX device structure.
+ */
+void tx_reset_stats(TX_Device* self);
+
+/**
+ * @brief Returns the next run of the frame being sent with edge scheduling.
+ *
+ * Runs are generated one ahead of the line, so a run takes a few bit steps of work.
+ *
+ * @param self Pointer to the TX device structure.
+ * @param run The run is written here.
+ * @return 1 if a run was written, 0 when the frames are done.
+ */
+uint8_t tx_next_run(TX_Device* self, TX_Run* run);
+
+/**
+ * @brief Compiles the queued frames into runs, for sending them by DMA or PIO.
+ *
+ * Takes the frames queued with tx_send_message / tx_send_bytes while the device is idle and
+ * writes the whole waveform, from the wake-up pulse to the last CRC bit, as runs. The line is
+ * low after the last run. Nothing is sent through the callbacks. Without tx_set_manual_start the
+ * first frame queued is already being sent, so there is nothing to compile.
+ *
+ * @param self Pointer to the TX device structure.
+ * @param runs Buffer for the runs.
+ * @param max_runs Size of the buffer, TX_MAX_MESSAGE_RUNS is enough for one message.
+ * @return Number of runs, 0 if nothing was queued, -1 if the runs do not fit (the frames are dropped).
+ */
+int16_t tx_compile_runs(TX_Device* self, TX_Run* runs, uint16_t max_runs);
+
 /**
  * @brief Callback function for the TX device.
  *
@@ -144,14 +498,17 @@ void tx_callback(TX_Device* self);
 /**
  * @brief Initializes the RX device.
  *
+ * The static sync pattern is built from the sampling count of the config.
+ *
  * @param self Pointer to the RX device structure.
  * @param result_callback Pointer to the callback function for receiving results.
  * @param set_recurring_trigger_time Pointer to the function for setting recurring trigger time.
  * @param cancel_trigger Pointer to the function for canceling trigger.
  * @param user_data User-defined data pointer.
+ * @param config Link timing of the device (copied), or NULL for RF_CONFIG_DEFAULT.
  */
 void rx_init( RX_Device* self, void* result_callback, void* set_recurring_trigger_time, 
-                void* cancel_trigger, void* user_data);
+                void* cancel_trigger, void* user_data, const RF_Config* config);
 
 /**
  * @brief Callback function for receiving RF signals.
@@ -164,6 +521,245 @@ void rx_init( RX_Device* self, void* result_callback, void* set_recurring_trigge
  */
 void rx_signal_callback(RX_Device* self, uint8_t signal_status);
 
+/**
+ * @brief Feeds a block of packed line samples to the RX device.
+ *
+ * Batched alternative to rx_signal_callback, e.g. for PIO/DMA captures. Sample i is bit (i % 32)
+ * of packed[i / 32]. Gives the same result as calling rx_signal_callback for every sample in order,
+ * but each bit is decided by a popcount over its mid-bit slots. A bit may span two blocks.
+ *
+ * @param self Pointer to the RX device structure.
+ * @param packed Samples packed 32 per word, LSB first.
+ * @param nbits Number of samples in the block.
+ */
+void rx_feed_samples(RX_Device* self, const uint32_t* packed, size_t nbits);
+
+/**
+ * @brief Edge callback for receiving RF signals.
+ *
+ * Alternative to rx_signal_callback for platforms that timestamp GPIO edges instead of sampling
+ * the line from a timer. The length of the run that ended at this edge is converted into bits
+ * using sync_rate and fed to the receiver state machine. Uses the static synchronization.
+ *
+ * @param self Pointer to the RX device structure.
+ * @param timestamp_us Timestamp of the edge in microseconds. May wrap.
+ * @param level Level of the signal after the edge (high or low).
+ */
+void rx_edge_callback(RX_Device* self, uint32_t timestamp_us, uint8_t level);
+
+/**
+ * @brief Flushes the complete bits of the current run to the edge receiver.
+ *
+ * The line may stay at the level of the last bit after a frame, so no edge closes the run.
+ * The platform calls this from a one-time trigger set RX_EDGE_FLUSH_BITS and a half bit times
+ * after the latest edge, and again every RX_EDGE_FLUSH_BITS bit times while it returns 1.
+ *
+ * @param self Pointer to the RX device structure.
+ * @param timestamp_us Current time in microseconds.
+ * @return 1 if a frame is still in progress and the flush should be repeated, 0 otherwise.
+ */
+uint8_t rx_edge_flush(RX_Device* self, uint32_t timestamp_us);
+
+/**
+ * @brief Starts reading a frame after the sync pattern was found outside the RX device.
+ *
+ * For front ends that detect the sync pattern themselves, e.g. the multi-channel receiver.
+ * The following bits are given with rx_bit_callback.
+ *
+ * @param self Pointer to the RX device structure.
+ */
+void rx_set_synchronized(RX_Device* self);
+
+/**
+ * @brief Feeds one decided bit to the RX device.
+ *
+ * For front ends that decide bits themselves. Only valid after rx_set_synchronized, while the
+ * device is not in the RX_SYNC state.
+ *
+ * @param self Pointer to the RX device structure.
+ * @param bit The received bit (0 or 1), or negative if the bit could not be decided.
+ */
+void rx_bit_callback(RX_Device* self, int8_t bit);
+
+/**
+ * @brief Sets the line coding of the RX device.
+ *
+ * Must match the line coding of the transmitter, see tx_set_line_coding.
+ * With RF_LINE_CODING_HAMMING74 each codeword is decoded by soft decision: the codeword closest to
+ * the line bits, each bit weighted by the majority of its samples, is taken. Any one wrong bit per
+ * codeword is corrected, and bits without a sample majority are guessed instead of losing sync.
+ * The corrected bits are counted in stats.corrected_bits.
+ *
+ * @param self Pointer to the RX device structure.
+ * @param coding The line coding.
+ */
+void rx_set_line_coding(RX_Device* self, RF_Line_Coding coding);
+
+/**
+ * @brief Enables receiving byte frames.
+ *
+ * The payload of a byte frame is written bit by bit into the given buffer, and the buffer is
+ * passed to bytes_callback once the CRC is received and matches. The data is only valid during the
+ * callback, the next frame overwrites it. Frames longer than the buffer are dropped. The quality
+ * of the frame is in message.quality of the RX device during the callback.
+ * Frames of the 64-bit format are still delivered through result_callback.
+ *
+ * @param self Pointer to the RX device structure.
+ * @param buffer Buffer for the payload.
+ * @param size Size of the buffer in bytes.
+ * @param bytes_callback Pointer to the callback function for receiving byte frames.
+ */
+void rx_set_byte_buffer(RX_Device* self, uint8_t* buffer, uint8_t size, void* bytes_callback);
+
+/**
+ * @brief Enables queueing of received messages.
+ *
+ * Instead of calling result_callback from the timer interrupt, received messages are copied
+ * into the given ring and the application takes them out with rx_poll_message. The ring is
+ * lock-free for one producer (the receiver) and one consumer. When the ring is full, new
+ * messages are dropped and counted in message_queue_overflow_count. Byte frames still go to
+ * bytes_callback.
+ *
+ * @param self Pointer to the RX device structure.
+ * @param buffer Storage for the ring, owned by the caller.
+ * @param size Number of entries in the buffer, a power of two (2 - 128).
+ */
+void rx_set_message_queue(RX_Device* self, RF_Message* buffer, uint8_t size);
+
+/**
+ * @brief Enables fractional sample timing.
+ *
+ * The sample period is kept in RX_PERIOD_FRACTION_BITS fixed point. On every sample the
+ * fraction is accumulated, and the whole microseconds to the next sample are handed to
+ * set_trigger_period, so the sample deadlines stay within half a microsecond of the exact
+ * ones over a frame of any length. Without it the period is rounded to whole microseconds.
+ *
+ * @param self Pointer to the RX device structure.
+ * @param set_trigger_period Pointer to the function changing the interval of the running
+ *                           recurring trigger. Called from the trigger callback, the new interval
+ *                           applies from this trigger to the next one. The port must keep the
+ *                           deadlines absolute (previous deadline + interval).
+ */
+void rx_set_fractional_timing(RX_Device* self, void* set_trigger_period);
+
+/**
+ * @brief Enables tracking of the bit phase while reading a frame.
+ *
+ * Transitions should fall between the last sampling slot of a bit and the first slot of the
+ * next one. With tracking enabled, every transition seen elsewhere moves the sampling window
+ * one slot toward it, so a transmitter running slightly fast or slow stays in the window over
+ * long frames. Applies to rx_signal_callback only.
+ *
+ * @param self Pointer to the RX device structure.
+ * @param enabled 1 to enable, 0 to keep the phase found at sync.
+ */
+void rx_set_phase_tracking(RX_Device* self, uint8_t enabled);
+
+/**
+ * @brief Enables repairing frames whose CRC does not match.
+ *
+ * The RX_REPAIR_BITS payload and CRC bits with the smallest sample majority are kept while a
+ * frame is read. When the CRC does not match, every combination of them is flipped in turn
+ * (Chase decoding), and the frame is delivered if one matches, with quality.repaired_bits set.
+ * Bits decided with the full majority are never flipped. Each try is another chance for a
+ * corrupted frame to pass the CRC, 2^RX_REPAIR_BITS - 1 in all. With RF_LINE_CODING_NRZ only,
+ * the other codings do not map line bits to data bits.
+ *
+ * With the repair, a payload or CRC bit without enough samples of either level no longer drops
+ * the frame: it is taken from the majority as a bit of low confidence. Likewise an undecided
+ * bit from rx_bit_callback is taken as 0 of confidence 0, and in the edge receiver a run
+ * shorter than half a bit is taken for a glitch, the next bit then having confidence 0.
+ *
+ * @param self Pointer to the RX device structure.
+ * @param enabled 1 to enable, 0 to drop every frame whose CRC does not match.
+ */
+void rx_set_crc_repair(RX_Device* self, uint8_t enabled);
+
+/**
+ * @brief Enables dropping repeated copies of a frame.
+ *
+ * Transmitters repeat every frame a few times. With the filter, a frame is delivered only if the
+ * same key was not delivered within the window, the other copies are dropped and counted in
+ * stats.duplicate_frames. The key is a hash of the length, the payload and the CRC, or with a
+ * key_mask of only those bits of a message (for example the device address, so one reading per
+ * device and window gets through). Byte frames are always keyed on the whole frame. The recent
+ * keys are kept in a small hash table, the oldest one is replaced when it is full. The window is
+ * anchored to the first copy, a new reading after the window is delivered even if it is equal.
+ *
+ * @param self Pointer to the RX device structure.
+ * @param table Storage for the table, owned by the caller, or NULL to disable the filter.
+ * @param size Number of entries in the table, a power of two (1 - 128).
+ * @param window Copies within this many ticks of the first one are dropped.
+ * @param key_mask Message bits forming the key, 0 for the whole frame and CRC.
+ * @param get_time Pointer to the function returning the current time in ticks, called with
+ * user_data when a frame is received. May wrap.
+ */
+void rx_set_dedup_filter(RX_Device* self, RX_Dedup_Entry* table, uint8_t size, uint32_t window,
+                         uint64_t key_mask, void* get_time);
+
+/**
+ * @brief Enables dropping messages for other receivers while they are received.
+ *
+ * Only messages whose bits under mask equal those of value are received, for example with
+ * PROTO_DEVICE_ADDRESS_MASK the messages of one device. The payload arrives MSB first, so the
+ * filter is checked as soon as the lowest bit of the mask has arrived. On a mismatch the
+ * receiver goes back to sync at once, counted as RX_LOSS_FILTERED, and skips the rest of the
+ * payload and the CRC. Messages too short to hold the masked bits are dropped after the length.
+ * The rest of a dropped frame is still on the line and may give a false sync, which times out
+ * like any other after the start symbol timeout.
+ * The bits are checked before the CRC, so a frame whose filtered bits are corrupted is dropped
+ * even with CRC repair. Byte frames are not filtered.
+ *
+ * @param self Pointer to the RX device structure.
+ * @param mask Message bits to check, 0 to receive every message.
+ * @param value Required value of the bits under mask.
+ */
+void rx_set_message_filter(RX_Device* self, uint64_t mask, uint64_t value);
+
+/**
+ * @brief Sets the timestamp hook for measuring the interrupt handler.
+ *
+ * With a hook, every rx_signal_callback, rx_feed_samples, rx_edge_callback and rx_edge_flush is
+ * timed into stats.isr. The tick is whatever the hook counts, e.g. us on the Pico. The other
+ * counters in stats are kept without a hook. Does nothing unless ENABLE_ISR_STATS is defined.
+ *
+ * @param self Pointer to the RX device structure.
+ * @param get_timestamp Pointer to the function returning the current time, or NULL to stop timing.
+ */
+void rx_set_timestamp_hook(RX_Device* self, void* get_timestamp);
+
+/**
+ * @brief Starts or stops recording the input of the RX device.
+ *
+ * Every sample given to rx_signal_callback and rx_feed_samples, or every rx_edge_callback and
+ * rx_edge_flush, is written to the capture (see rf_capture.h), so the reception can be replayed
+ * offline. The header takes the config, line coding, phase tracking and CRC repair of the
+ * device, so set those first. The bit time found by an external synchronizer is not recorded.
+ *
+ * @param self Pointer to the RX device structure.
+ * @param capture Capture initialized with rf_capture_init, or NULL to stop recording. The
+ *                caller ends it with rf_capture_finish.
+ */
+void rx_set_capture(RX_Device* self, RF_Capture* capture);
+
+/**
+ * @brief Clears the statistics of the RX device.
+ *
+ * @param self Pointer to the RX device structure.
+ */
+void rx_reset_stats(RX_Device* self);
+
+/**
+ * @brief Takes the oldest message from the message queue.
+ *
+ * May be called outside of the interrupt context while the receiver is running.
+ *
+ * @param self Pointer to the RX device structure.
+ * @param message The message is copied here.
+ * @return 1 if a message was taken, 0 if the queue is empty.
+ */
+uint8_t rx_poll_message(RX_Device* self, RF_Message* message);
+
 /**
  * @brief Sets the external synchronizer for the RX device.
  *
@@ -178,13 +774,26 @@ void rx_set_external_synchronizer(RX_Device* self, RX_Synchronizer* synchronizer
  * @brief Sets the detected transmission rate and adjusts trigger time.
  *
  * Called by the external synchronizer after detecting the transmission rate from sync signal. 
+ * The fraction of the rate is kept with rx_set_fractional_timing. Converts the rate for
+ * rx_set_detected_bit_period, which avoids the float math in an interrupt handler.
  * 
  * @param self Pointer to the RX device structure.
- * @param rate Detected transmission rate of 1 bit.
+ * @param rate Detected transmission rate of 1 bit (us).
  * @param signal_status Status of the last signal (high or low).
  */
 void rx_set_detected_transmission_rate(RX_Device* self, float rate, uint8_t signal_status);
 
+/**
+ * @brief Sets the detected bit period and adjusts trigger time, in fixed point.
+ *
+ * As rx_set_detected_transmission_rate, with integer math only.
+ *
+ * @param self Pointer to the RX device structure.
+ * @param bit_period Detected period of 1 bit (us), RX_PERIOD_FRACTION_BITS fixed point.
+ * @param signal_status Status of the last signal (high or low).
+ */
+void rx_set_detected_bit_period(RX_Device* self, uint32_t bit_period, uint8_t signal_status);
+
 /**
  * @brief Starts the receiving process for the RX device.
  *
@@ -192,6 +801,15 @@ void rx_set_detected_transmission_rate(RX_Device* self, float rate, uint8_t sign
  */
 void rx_start_receiving(RX_Device* self);
 
+/**
+ * @brief Starts the receiving process for an RX device driven by rx_edge_callback.
+ *
+ * Unlike rx_start_receiving, no recurring sampling trigger is set.
+ *
+ * @param self Pointer to the RX device structure.
+ */
+void rx_start_edge_receiving(RX_Device* self);
+
 /**
  * @brief Stops the receiving process for the RX device.
  *
@@ -200,41 +818,117 @@ void rx_start_receiving(RX_Device* self);
 void rx_stop_receiving(RX_Device* self);
 
 /**
- * @brief Computes the CRC-8 checksum for the given data.
+ * @brief Computes the CRC-16 (CCITT) checksum for the given data.
  *
- * This function calculates the 8-bit Cyclic Redundancy Check (CRC) for the 
- * provided data array using the specified initial CRC value.
+ * Byte-wise, using a 256-entry lookup table.
  *
  * @param data Pointer to the data array for which the CRC is to be computed.
  * @param length The length of the data array.
- * @param initial_crc The initial CRC value to start the computation.
- * @return The computed CRC-8 checksum.
+ * @param initial_crc The initial CRC value to start the computation, RF_CRC16_INITIAL for a new CRC.
+ * @return The computed CRC-16 checksum.
  */
-uint8_t rf_crc8(const uint8_t *data, size_t length, uint8_t initial_crc);
+uint16_t rf_crc16(const uint8_t *data, size_t length, uint16_t initial_crc);
 
 /**
- * @brief Adds an 8-bit CRC to the RF message.
+ * @brief Updates a CRC-16 (CCITT) checksum with one nibble, using a 16-entry lookup table.
  *
- * This function calculates an 8-bit CRC for the given RF message and assigns it to the message's CRC field.
- * The most significant bit (MSB) of the CRC field is set to indicate the presence of the CRC, and the actual
- * CRC value is stored in the least significant byte (LSB).
+ * @param crc The CRC so far.
+ * @param nibble The next 4 bits, MSB first.
+ * @return The updated CRC.
+ */
+uint16_t rf_crc16_nibble(uint16_t crc, uint8_t nibble);
+
+/**
+ * @brief Starts an incremental CRC-16.
  *
- * @param message Pointer to the RF_Message structure containing the message to which the CRC will be added.
+ * @param self Pointer to the CRC state.
  */
-void rf_add_crc8(RF_Message* message);
+void rf_crc16_init(RF_CRC16* self);
 
 /**
- * @brief Verifies the CRC8 checksum of an RF message.
+ * @brief Adds one bit to an incremental CRC-16. Bits are collected into nibbles.
  *
- * This function checks the CRC8 checksum of the given RF message to ensure data integrity.
- * It extracts the CRC flag and the stored CRC from the message, computes the CRC of the 
- * message content, and compares it with the stored CRC.
+ * @param self Pointer to the CRC state.
+ * @param bit The bit (0 or 1).
+ */
+void rf_crc16_add_bit(RF_CRC16* self, uint8_t bit);
+
+/**
+ * @brief Adds the bit_count lowest bits of value to an incremental CRC-16, MSB first.
+ *
+ * @param self Pointer to the CRC state.
+ * @param value The bits.
+ * @param bit_count Number of bits (0 - 64).
+ */
+void rf_crc16_add_bits(RF_CRC16* self, uint64_t value, uint8_t bit_count);
+
+/**
+ * @brief Adds one byte to an incremental CRC-16.
+ *
+ * Uses the 16-entry nibble table only, as the rest of the incremental CRC.
+ *
+ * @param self Pointer to the CRC state.
+ * @param byte The byte.
+ */
+void rf_crc16_add_byte(RF_CRC16* self, uint8_t byte);
+
+/**
+ * @brief Returns the CRC-16 of the bits added so far.
+ *
+ * @param self Pointer to the CRC state.
+ * @return The CRC.
+ */
+uint16_t rf_crc16_value(const RF_CRC16* self);
+
+/**
+ * @brief Computes the CRC field of a message frame.
+ *
+ * The CRC covers the length field (PAYLOAD_LENGTH bits) and the message_length payload bits as
+ * they are sent. The TX device computes it while sending, and the RX device drops frames whose
+ * CRC field does not match.
+ *
+ * @param message Pointer to the RF_Message structure.
+ * @return The CRC.
+ */
+uint16_t rf_crc16_message(const RF_Message* message);
+
+/**
+ * @brief Computes the CRC field of a byte frame, covering the length byte and the payload.
+ *
+ * @param data Payload bytes.
+ * @param length Number of payload bytes.
+ * @return The CRC.
+ */
+uint16_t rf_crc16_bytes(const uint8_t* data, uint8_t length);
+
+// Configuration functions
+
+/**
+ * @brief Clamps the configuration to the supported ranges: an even sampling_count of
+ * RF_MIN_SAMPLING_COUNT - MAX_SAMPLING_COUNT, sampling_tolerance below (sampling_count - 2) / 2,
+ * bit_time of at least sampling_count, an even sync_symbol_length of RF_MIN_SYNC_SYMBOL_LENGTH -
+ * SYNC_SYMBOL_LENGTH and frame_gap up to sync_symbol_length.
  *
- * @param message Pointer to the RF_Message structure containing the message and its CRC.
- * @return true if the CRC flag is not set or if the computed CRC matches the stored CRC,
- *         false otherwise.
+ * @param config Pointer to the configuration, changed in place.
+ * @return 1 if a value was changed, 0 if the configuration was valid.
  */
-uint8_t rf_verify_crc8(RF_Message* message);
+uint8_t rf_config_clamp(RF_Config* config);
 
+// Statistics functions
+
+/**
+ * @brief Clears the ISR duration statistics.
+ *
+ * @param stats Pointer to the statistics.
+ */
+void rf_isr_stats_reset(RF_ISR_Stats* stats);
+
+/**
+ * @brief Adds one interrupt handler duration to the statistics.
+ *
+ * @param stats Pointer to the statistics.
+ * @param duration Duration in timestamp ticks.
+ */
+void rf_isr_stats_add(RF_ISR_Stats* stats, uint32_t duration);
 
 #endif // RFDEVICE_H
\ No newline at end of file
@@ -0,0 +1,98 @@
+/**
+ * @file rf_trace.h
+ * @brief Header file for the binary event tracer.
+ *
+ * The tracer records compact binary events (timestamp, event id, 16-bit argument) into a
+ * caller-owned ring. Writing an event takes a few stores, so it can be left on in interrupt
+ * handlers. The records are read and formatted later from thread context.
+ *
+ * The ring is lock-free for any number of writers (nested interrupts) and one reader. On the
+ * Pico the record is reserved with the interrupts disabled for a few instructions, so the
+ * writers must run on one core. When the
+ * reader falls behind, the oldest records are overwritten and counted as lost. Each record
+ * carries its sequence number, so the reader can tell a complete record from one being
+ * overwritten.
+ *
+ * The devices trace through the TRACE macro of debug_logging.h, compiled in with ENABLE_TRACING.
+ */
+
+#ifndef RF_TRACE_H
+#define RF_TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef enum
+{
+    RF_TRACE_RX_STATE = 1,              // arg: new RX_State
+    RF_TRACE_RX_SYNC_LOSS,              // arg: RX_Sync_Loss
+    RF_TRACE_RX_FRAME,                  // arg: CRC of the frame delivered
+    RF_TRACE_TX_STATE,                  // arg: new TX_State
+    RF_TRACE_SYNC_OUTLIERS,             // arg: edges rejected by the edge synchronizer fit
+    RF_TRACE_SYNC_RATE,                 // arg: bit time fitted by the edge synchronizer (us)
+    RF_TRACE_RX_DUPLICATE,              // arg: CRC of the frame dropped by the dedup filter
+    RF_TRACE_USER = 0x80                // First id free for the application
+} RF_Trace_Event;
+
+typedef struct
+{
+    uint32_t    sequence;               // Index of the record + 1, 0 while being written
+    uint32_t    timestamp;              // Ticks of the timestamp hook
+    uint16_t    arg;
+    uint8_t     event;
+} RF_Trace_Record;
+
+/**
+ * @brief Starts tracing into the given ring.
+ *
+ * @param buffer Storage for the ring, owned by the caller. NULL stops tracing.
+ * @param size Number of records in the buffer, a power of two.
+ * @param get_timestamp Pointer to the function returning the current time, or NULL for no timestamps.
+ * @param user_data User-defined data pointer for get_timestamp.
+ */
+void rf_trace_init(RF_Trace_Record* buffer, uint16_t size, void* get_timestamp, void* user_data);
+
+/**
+ * @brief Records an event. Does nothing before rf_trace_init.
+ *
+ * @param event Event id, RF_Trace_Event or from RF_TRACE_USER on.
+ * @param arg Argument of the event.
+ */
+void rf_trace(uint8_t event, uint16_t arg);
+
+/**
+ * @brief Takes the oldest record from the ring.
+ *
+ * Only one reader at a time.
+ *
+ * @param record The record is copied here.
+ * @return 1 if a record was copied, 0 if the ring is empty.
+ */
+uint8_t rf_trace_read(RF_Trace_Record* record);
+
+/**
+ * @brief Returns the number of records overwritten before they were read.
+ *
+ * @return The number of lost records.
+ */
+uint32_t rf_trace_lost_count(void);
+
+/**
+ * @brief Returns the name of an event id.
+ *
+ * @param event Event id.
+ * @return The name, "user" for application events and "?" for unknown ones.
+ */
+const char* rf_trace_event_name(uint8_t event);
+
+/**
+ * @brief Formats a record as text.
+ *
+ * @param record The record.
+ * @param text Output buffer.
+ * @param size Size of the output buffer.
+ * @return Length of the text, as snprintf.
+ */
+int rf_trace_format(const RF_Trace_Record* record, char* text, size_t size);
+
+#endif // RF_TRACE_H
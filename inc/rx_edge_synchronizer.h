@@ -0,0 +1,79 @@
+/**
+ * @file rx_edge_synchronizer.h
+ * @brief This file contains the definition of the edge timestamp synchronizer.
+ *
+ * The edge synchronizer is an external synchronizer (RX_Synchronizer) that detects the bit time
+ * of the transmitter from the sync symbol. Every edge of the line is timestamped while waiting
+ * for sync. Edges one bit apart are collected, and the bit period is fitted to them by integer
+ * least squares. Edges too far from the fitted line are dropped and the fit is redone. The
+ * result is handed to rx_set_detected_bit_period with sub-microsecond resolution. Bit times more
+ * than RX_EDGE_SYNC_RATE_RANGE % off the configured one are not taken for a sync symbol.
+ * Nothing runs between edges, so there is no interrupt load on an idle line.
+ */
+
+#ifndef RX_EDGE_SYNCHRONIZER_H
+#define RX_EDGE_SYNCHRONIZER_H
+
+#include <stdint.h>
+#include "rf_device.h"
+
+#define RX_EDGE_SYNC_RATE_RANGE     25      // Accepted bit times, +- % of config.bit_time of the RX device.
+                                            // Under 50, so the wake-up halves are never taken for sync bits
+#define RX_EDGE_SYNC_MAX_EDGES      16      // Edges fitted, limited to half of the sync symbol
+#define RX_EDGE_SYNC_MIN_EDGES      4
+#define RX_EDGE_SYNC_FRACTION_BITS  8       // Fixed point of the fitted period
+
+typedef struct RX_Edge_Synchronizer RX_Edge_Synchronizer;
+
+struct RX_Edge_Synchronizer
+{
+    RX_Synchronizer base;
+    RX_Device*  rx_device;
+    uint8_t     active;                             // Waiting for sync
+
+    uint32_t    first_timestamp;                    // us, edge 0
+    uint32_t    last_timestamp;                     // us, latest edge taken
+    uint32_t    offset[RX_EDGE_SYNC_MAX_EDGES];     // us from edge 0
+    uint8_t     bit_index[RX_EDGE_SYNC_MAX_EDGES];  // bits from edge 0
+    uint8_t     edge_count;
+    uint8_t     needed_edges;
+    uint32_t    bit_time;                           // us, running estimate from the edges so far
+    uint32_t    fitted_bit_time;                    // Fitted period, RX_EDGE_SYNC_FRACTION_BITS fixed point
+    uint32_t    min_bit_time;                       // us, accepted range of the bit time
+    uint32_t    max_bit_time;
+
+    void (*enable_edges)(uint8_t /*enabled*/, void* /*user_data*/);
+    void* user_data;
+};
+
+/**
+ * @brief Initializes the edge synchronizer.
+ *
+ * Set it to an RX device with rx_set_external_synchronizer.
+ *
+ * @param self Pointer to the edge synchronizer structure.
+ * @param enable_edges Pointer to the function enabling the edge interrupts of the line, or NULL.
+ *                     Edges are only needed while waiting for sync.
+ * @param user_data User-defined data pointer.
+ */
+void rx_edge_sync_init(RX_Edge_Synchronizer* self, void* enable_edges, void* user_data);
+
+/**
+ * @brief Callback function for the edges of the line.
+ *
+ * Function called on every rising and falling edge. Ignored when not waiting for sync.
+ *
+ * @param self Pointer to the edge synchronizer structure.
+ * @param timestamp_us Timestamp of the edge in microseconds. May wrap.
+ * @param level Level of the signal after the edge (high or low).
+ */
+void rx_edge_sync_callback(RX_Edge_Synchronizer* self, uint32_t timestamp_us, uint8_t level);
+
+/**
+ * @brief Stops waiting for sync.
+ *
+ * @param self Pointer to the edge synchronizer structure.
+ */
+void rx_edge_sync_stop(RX_Edge_Synchronizer* self);
+
+#endif // RX_EDGE_SYNCHRONIZER_H
@@ -0,0 +1,92 @@
+/**
+ * @file rx_multi_device.h
+ * @brief This file contains the definition of the multi-channel RX device.
+ *
+ * The multi-channel RX device decodes up to 32 receivers from one sampling trigger. Each tick
+ * takes a snapshot of all input levels (e.g. a GPIO bank read), where bit c is the level of
+ * channel c. Sampling and sync pattern matching run bit-sliced over all channels at once, so
+ * the cost per tick is nearly independent of the number of channels. Decided bits are fed to
+ * a per-channel RX_Device, which delivers frames through its own result_callback.
+ */
+
+#ifndef RX_MULTI_DEVICE_H
+#define RX_MULTI_DEVICE_H
+
+#include <stdint.h>
+#include "rf_device.h"
+
+#define RX_MULTI_MAX_CHANNELS       32
+#define RX_MULTI_COUNTER_BITS       5      // Width of the bit-sliced counters, must hold MAX_SAMPLING_COUNT - 1
+#define RX_MULTI_HISTORY_LENGTH     (MAX_SAMPLING_COUNT * RX_SYNC_PATTERN_BITS)
+
+typedef struct RX_Multi_Device RX_Multi_Device;
+
+struct RX_Multi_Device
+{
+    RF_Config   config;                             // Shared by all channels
+    RX_Device   channels[RX_MULTI_MAX_CHANNELS];    // Channel c decodes bit c of the snapshot
+
+    uint32_t    channel_mask;                       // Channels in use
+    uint32_t    locked_mask;                        // Channels past sync, reading a frame
+
+    // Bit-sliced counters: bit c of word i is bit i of the counter of channel c
+    uint32_t    slot[RX_MULTI_COUNTER_BITS];        // Sampling slot within the bit, as RX_Bit.sync_index
+    uint32_t    high_count[RX_MULTI_COUNTER_BITS];  // High samples in the mid-bit slots
+
+    uint32_t    history[RX_MULTI_HISTORY_LENGTH];   // Latest snapshots for sync matching, ring buffer
+    uint8_t     history_length;                     // Snapshots in use, sampling_count * RX_SYNC_PATTERN_BITS
+    uint8_t     history_index;                      // Position of the latest snapshot
+    uint8_t     needed_count;                       // Samples needed to identify a bit, as in rx_decide_bit
+    uint64_t    sync_pattern;                       // As RX_Device.sync_pattern, latest sample in LSB
+
+    void (*set_recurring_trigger_time)(uint64_t /*time_to_trigger*/, void* /*trigger_user_data*/);
+    void (*cancel_trigger)(void* /*trigger_user_data*/);
+    void* user_data;
+};
+
+/**
+ * @brief Initializes the multi-channel RX device.
+ *
+ * @param self Pointer to the multi-channel RX device structure.
+ * @param set_recurring_trigger_time Pointer to the function for setting recurring trigger time.
+ * @param cancel_trigger Pointer to the function for canceling trigger.
+ * @param user_data User-defined data pointer.
+ * @param config Link timing of all channels (copied), or NULL for RF_CONFIG_DEFAULT.
+ */
+void rx_multi_init(RX_Multi_Device* self, void* set_recurring_trigger_time,
+                    void* cancel_trigger, void* user_data, const RF_Config* config);
+
+/**
+ * @brief Enables a channel of the multi-channel RX device.
+ *
+ * @param self Pointer to the multi-channel RX device structure.
+ * @param channel Channel number, i.e. the bit of the snapshot (0 - 31).
+ * @param result_callback Pointer to the callback function for the frames of this channel.
+ */
+void rx_multi_add_channel(RX_Multi_Device* self, uint8_t channel, void* result_callback);
+
+/**
+ * @brief Callback function for receiving RF signals on all channels.
+ *
+ * Function called by the timer ticks.
+ *
+ * @param self Pointer to the multi-channel RX device structure.
+ * @param snapshot Levels of all inputs, bit c is the level of channel c.
+ */
+void rx_multi_signal_callback(RX_Multi_Device* self, uint32_t snapshot);
+
+/**
+ * @brief Starts the receiving process for all channels.
+ *
+ * @param self Pointer to the multi-channel RX device structure.
+ */
+void rx_multi_start_receiving(RX_Multi_Device* self);
+
+/**
+ * @brief Stops the receiving process for all channels.
+ *
+ * @param self Pointer to the multi-channel RX device structure.
+ */
+void rx_multi_stop_receiving(RX_Multi_Device* self);
+
+#endif // RX_MULTI_DEVICE_H
@@ -1,23 +1,137 @@
 #include "protocol.h"
-#include <math.h>
 
-void add_temperature(float temperature, uint64_t *data)
+const proto_field proto_fields[PROTO_FIELD_COUNT] =
 {
-    // Nullify the previous temperature bits
-    uint64_t mask = (~0ULL << 7) ^ (~0ULL << 19);
-    *data &= ~mask;
-    
-    int8_t int_temp = (int8_t) temperature;
-    float fract = fabs(temperature - (int)temperature); 
-    uint8_t decimal = (uint8_t)(int)(fract * 10); 
-    *data |= (uint64_t) decimal << 7ULL;
-    *data |= (uint64_t) int_temp << 11ULL;
+#define PROTO_FIELD_ENTRY(name, shift, bits, coding, scale, offset, protocol) \
+    { shift, bits, coding, protocol, scale, offset },
+    PROTO_FIELDS(PROTO_FIELD_ENTRY)
+#undef PROTO_FIELD_ENTRY
+};
+
+// The last field ends at the top of the data
+#define PROTO_FIELD_END(name, shift, bits, coding, scale, offset, protocol) \
+    _Static_assert(shift + bits <= PROTO_DATA_LENGTH_BITS, "Field " #name " outside the data");
+PROTO_FIELDS(PROTO_FIELD_END)
+#undef PROTO_FIELD_END
+
+static uint16_t proto_encode(const proto_field *field, int16_t value)
+{
+    uint16_t const max_raw = (1U << field->bits) - 1;
+    if (field->coding == PROTO_CODING_DECIMAL)
+    {
+        // Floor of the value in the full part, the decimal digit is never negative
+        int16_t const max_value = (int16_t) (max_raw >> 5) * 10 + 9;
+        int16_t const min_value = -(int16_t) ((max_raw >> 5) + 1) * 10;
+        value = value > max_value ? max_value : (value < min_value ? min_value : value);
+        int16_t const full = value >= 0 ? value / 10 : -((9 - value) / 10);
+        uint8_t const decimal = value - full * 10;
+        return (((uint16_t) full << 4) | decimal) & max_raw;
+    }
+    if (value <= field->offset)
+    {
+        return 0;
+    }
+    uint16_t const raw = ((uint16_t) (value - field->offset) + field->scale / 2) / field->scale;
+    return raw > max_raw ? max_raw : raw;
+}
+
+static int16_t proto_decode(const proto_field *field, uint16_t raw)
+{
+    if (field->coding == PROTO_CODING_DECIMAL)
+    {
+        // Sign extend the full part
+        int16_t const full = (int16_t) (raw >> 4) - ((raw >> (field->bits - 1)) & 1 ? 1 << (field->bits - 4) : 0);
+        return full * 10 + (raw & 0xF);
+    }
+    return (int16_t) raw * field->scale + field->offset;
+}
+
+static inline uint16_t proto_get_raw(const proto_field *field, uint64_t data)
+{
+    return (data >> field->shift) & ((1U << field->bits) - 1);
+}
+
+void proto_set_field(proto_field_id field_id, int16_t value, uint64_t *data)
+{
+    const proto_field *field = &proto_fields[field_id];
+    uint64_t const mask = (uint64_t) ((1U << field->bits) - 1) << field->shift;
+    *data = (*data & ~mask) | ((uint64_t) proto_encode(field, value) << field->shift);
+}
+
+int16_t proto_get_field(proto_field_id field_id, const uint64_t *data)
+{
+    const proto_field *field = &proto_fields[field_id];
+    return proto_decode(field, proto_get_raw(field, *data));
+}
+
+uint8_t proto_pack(const proto_reading *reading, uint64_t *data)
+{
+    uint8_t const protocol = reading->value[PROTO_FIELD_PROTOCOL];
+    uint8_t length = 0;
+    *data = 0;
+    for (uint8_t i = 0; i < PROTO_FIELD_COUNT; i++)
+    {
+        const proto_field *field = &proto_fields[i];
+        if (field->protocol && !(protocol & field->protocol))
+        {
+            continue;
+        }
+        *data |= (uint64_t) proto_encode(field, reading->value[i]) << field->shift;
+        length = field->shift + field->bits;
+    }
+    return length;
+}
+
+static inline void proto_unpack_one(uint64_t data, proto_reading *reading)
+{
+    uint8_t const protocol = proto_get_raw(&proto_fields[PROTO_FIELD_PROTOCOL], data);
+    for (uint8_t i = 0; i < PROTO_FIELD_COUNT; i++)
+    {
+        const proto_field *field = &proto_fields[i];
+        reading->value[i] = (field->protocol && !(protocol & field->protocol)) ? 0 :
+                            proto_decode(field, proto_get_raw(field, data));
+    }
 }
 
-float get_temperature(uint64_t *data)
+void proto_unpack(const uint64_t *data, proto_reading *reading)
 {
-    int8_t decimal_part = (*data >> 7) & PROTO_TEMPERATURE_DECIMAL_MASK;
-    int8_t int_part = (*data >> 11) & PROTO_TEMPERATURE_INT_MASK;
-    return (int_part + (decimal_part / 10.0f));
+    proto_unpack_one(*data, reading);
 }
 
+void proto_unpack_batch(const uint64_t *data, proto_reading *readings, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        proto_unpack_one(data[i], &readings[i]);
+    }
+}
+
+void add_temperature(int16_t temperature, uint64_t *data)
+{
+    proto_set_field(PROTO_FIELD_TEMPERATURE, temperature, data);
+}
+
+int16_t get_temperature(uint64_t *data)
+{
+    return proto_get_field(PROTO_FIELD_TEMPERATURE, data);
+}
+
+void add_humidity(int16_t humidity, uint64_t *data)
+{
+    proto_set_field(PROTO_FIELD_HUMIDITY, humidity, data);
+}
+
+int16_t get_humidity(uint64_t *data)
+{
+    return proto_get_field(PROTO_FIELD_HUMIDITY, data);
+}
+
+void add_co2(int16_t co2, uint64_t *data)
+{
+    proto_set_field(PROTO_FIELD_CO2, co2, data);
+}
+
+int16_t get_co2(uint64_t *data)
+{
+    return proto_get_field(PROTO_FIELD_CO2, data);
+}
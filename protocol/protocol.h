@@ -7,7 +7,7 @@
 #define PROTO_TEMPERATURE 0b001
 #define PROTO_HUMIDITY 0b010
 #define PROTO_CO2 0b100
-#define PROTO_DATA_LENGTH_BITS 27
+#define PROTO_DATA_LENGTH_BITS 31
 
 //#define PROTO_MAX_ADDRESS_LENGTH_BITS 4
 
@@ -25,15 +25,105 @@ Protocol:
 - 010 Humidity
 - 100 CO2
 And possible combos
+
+Temperature: 0.1 C steps, the full part is the floor of the value (two's complement) and the
+decimal part the tenths above it, so -2.5 C is -3 and 5. Range -128.0 - 127.9 C.
+Humidity: 2 %RH steps, 0 - 126 %RH.
+CO2: 100 ppm steps, 0 - 6300 ppm.
 */
 
+typedef enum
+{
+    PROTO_CODING_LINEAR = 0,    // value = raw * scale + offset
+    PROTO_CODING_DECIMAL        // Signed full part and a decimal digit, value in tenths
+} proto_coding;
+
+// Fields from the LSB: name, lowest bit, bits, coding, scale, offset, protocol bit (0 = always present)
+#define PROTO_FIELDS(X) \
+    X(ADDRESS,      0,  4, PROTO_CODING_LINEAR,    1, 0, 0)                 \
+    X(PROTOCOL,     4,  3, PROTO_CODING_LINEAR,    1, 0, 0)                 \
+    X(TEMPERATURE,  7, 12, PROTO_CODING_DECIMAL,   1, 0, PROTO_TEMPERATURE) \
+    X(HUMIDITY,    19,  6, PROTO_CODING_LINEAR,    2, 0, PROTO_HUMIDITY)    \
+    X(CO2,         25,  6, PROTO_CODING_LINEAR,  100, 0, PROTO_CO2)
+
+typedef enum
+{
+#define PROTO_FIELD_ID(name, shift, bits, coding, scale, offset, protocol) PROTO_FIELD_##name,
+    PROTO_FIELDS(PROTO_FIELD_ID)
+#undef PROTO_FIELD_ID
+    PROTO_FIELD_COUNT
+} proto_field_id;
+
+typedef struct
+{
+    uint8_t shift;
+    uint8_t bits;
+    uint8_t coding;             // proto_coding
+    uint8_t protocol;           // Protocol bit of the field, 0 if always present
+    int16_t scale;
+    int16_t offset;
+} proto_field;
+
+extern const proto_field proto_fields[PROTO_FIELD_COUNT];
+
+// All fields of a message, in the units above (temperature in 0.1 C, humidity in %RH, CO2 in ppm)
+typedef struct
+{
+    int16_t value[PROTO_FIELD_COUNT];  // By proto_field_id, 0 for the fields not in the protocol
+} proto_reading;
+
 inline void generate_empty_data(uint8_t device_address, uint8_t protocol, uint64_t *data)
 {
     *data = (uint64_t) device_address & 0xFULL;
     *data |= (uint64_t) protocol << 4ULL;
 }
 
-void add_temperature(float temperature, uint64_t *data);
+/**
+ * @brief Sets one field of the data, the value is rounded to the step and clamped to the range.
+ *
+ * @param field The field.
+ * @param value Value in the units of the field.
+ * @param data The data.
+ */
+void proto_set_field(proto_field_id field, int16_t value, uint64_t *data);
+
+/**
+ * @brief Gets one field of the data, whether or not the protocol has it.
+ *
+ * @param field The field.
+ * @param data The data.
+ * @return Value in the units of the field.
+ */
+int16_t proto_get_field(proto_field_id field, const uint64_t *data);
+
+/**
+ * @brief Packs a reading, the fields not in reading->value[PROTO_FIELD_PROTOCOL] are left out.
+ *
+ * @param reading The reading.
+ * @param data The data is written here.
+ * @return Message length in bits, up to the last field of the protocol.
+ */
+uint8_t proto_pack(const proto_reading *reading, uint64_t *data);
+
+/**
+ * @brief Unpacks the fields of the data, the fields not in the protocol are set to 0.
+ *
+ * @param data The data.
+ * @param reading The reading is written here.
+ */
+void proto_unpack(const uint64_t *data, proto_reading *reading);
+
+/**
+ * @brief Unpacks a batch of data, for example stored messages on a gateway.
+ *
+ * @param data The data of count messages.
+ * @param readings Count readings are written here.
+ * @param count Number of messages.
+ */
+void proto_unpack_batch(const uint64_t *data, proto_reading *readings, size_t count);
+
+// Temperature in 0.1 C
+void add_temperature(int16_t temperature, uint64_t *data);
 
 inline uint8_t get_device_address(uint64_t *data)
 {
@@ -45,6 +135,16 @@ inline uint8_t get_protocol(uint64_t *data)
     return (*data >> 4) & PROTO_PROTOCOL_MASK;
 }
 
-float get_temperature(uint64_t *data);
+int16_t get_temperature(uint64_t *data);
+
+// Humidity in %RH
+void add_humidity(int16_t humidity, uint64_t *data);
+
+int16_t get_humidity(uint64_t *data);
+
+// CO2 in ppm
+void add_co2(int16_t co2, uint64_t *data);
+
+int16_t get_co2(uint64_t *data);
 
 #endif
\ No newline at end of file
@@ -6,6 +6,36 @@
 #include "pico_synchronizer.h"
 #include "debug_logging.h"
 
+typedef struct
+{
+    pico_gpio_irq_handler handler;
+    void* instance;
+} pico_gpio_irq_entry;
+
+static pico_gpio_irq_entry gpio_irq_table[NUM_BANK0_GPIOS]; // needed due to the interrupt handlers
+
+static void __not_in_flash_func(pico_gpio_irq_dispatch)(uint gpio, uint32_t events)
+{
+    if (gpio < NUM_BANK0_GPIOS && gpio_irq_table[gpio].handler)
+    {
+        gpio_irq_table[gpio].handler(gpio_irq_table[gpio].instance, gpio, events);
+    }
+}
+
+void pico_gpio_set_irq_handler(uint8_t pin, uint32_t events, pico_gpio_irq_handler handler, void* instance)
+{
+    gpio_irq_table[pin].handler = handler;
+    gpio_irq_table[pin].instance = instance;
+    gpio_set_irq_enabled_with_callback(pin, events, true, pico_gpio_irq_dispatch);
+}
+
+void pico_gpio_clear_irq_handler(uint8_t pin, uint32_t events)
+{
+    gpio_set_irq_enabled(pin, events, false);
+    gpio_irq_table[pin].handler = NULL;
+    gpio_irq_table[pin].instance = NULL;
+}
+
 // Callback functions
 
 static void pico_tx_set_signal(uint8_t is_high, void* user_data)
@@ -16,7 +46,7 @@ static void pico_tx_set_signal(uint8_t is_high, void* user_data)
 static void pico_data_read_callback(void *user_data)
 {
     rf_pico_receiver* receiver = (rf_pico_receiver*) user_data;
-    bool gpio_value = gpio_get(GPIO_PIN);
+    bool gpio_value = gpio_get(receiver->pin);
     rx_signal_callback(&(receiver->rx_device), (uint8_t) gpio_value);
 }
 
@@ -40,9 +70,10 @@ static bool pico_tx_repeating_timer_callback(struct repeating_timer *t)
     return true;
 }
 
-static uint64_t pico_get_timestamp_us_callback()
+// Timestamp hook for the ISR statistics and the dedup filter
+static uint32_t __not_in_flash_func(pico_get_timestamp_us_callback)(void* user_data)
 {
-    return to_us_since_boot(get_absolute_time());
+    return time_us_32();
 }
 
 static void pico_tx_set_onetime_trigger_time(uint64_t time_to_trigger, void* user_data)
@@ -78,6 +109,66 @@ static void pico_rx_set_recurring_trigger_time(uint64_t time_to_trigger, void* u
     add_repeating_timer_us(time_to_trigger * -1, pico_rx_repeating_timer_callback, user_data, timer);
 }
 
+// Called from the repeating timer callback, the SDK schedules the next alarm from delay_us
+static void pico_rx_set_trigger_period(uint32_t period, void* user_data)
+{
+    rf_pico_receiver* receiver = (rf_pico_receiver*) user_data;
+    receiver->timer.delay_us = -((int64_t) period);
+}
+
+static int64_t pico_rx_edge_flush_callback(alarm_id_t id, void *user_data)
+{
+    rf_pico_receiver* receiver = (rf_pico_receiver*) user_data;
+    if (rx_edge_flush(&(receiver->rx_device), time_us_32()))
+    {
+        // Repeat keeping the phase of the original alarm
+        return -((int64_t) RX_EDGE_FLUSH_BITS * receiver->rx_device.sync_rate);
+    }
+    receiver->flush_alarm = 0;
+    return 0;
+}
+
+static void __not_in_flash_func(pico_rx_edge_irq_callback)(void* instance, uint gpio, uint32_t events)
+{
+    uint32_t const timestamp = time_us_32();
+    rf_pico_receiver* const receiver = (rf_pico_receiver*) instance;
+    uint16_t const rate = receiver->rx_device.sync_rate;
+    uint8_t level = (events & GPIO_IRQ_EDGE_RISE) ? 1 : 0;
+
+    if ((events & GPIO_IRQ_EDGE_RISE) && (events & GPIO_IRQ_EDGE_FALL))
+    {
+        // Both edges latched, trust the current pin state
+        level = gpio_get(gpio);
+    }
+    rx_edge_callback(&(receiver->rx_device), timestamp, level);
+
+    if (receiver->flush_alarm > 0)
+    {
+        cancel_alarm(receiver->flush_alarm);
+    }
+    receiver->flush_alarm = add_alarm_in_us(RX_EDGE_FLUSH_BITS * rate + rate / 2,
+                                            pico_rx_edge_flush_callback, receiver, true);
+}
+
+static bool pico_multi_rx_repeating_timer_callback(struct repeating_timer *t)
+{
+    rf_pico_multi_receiver* receiver = (rf_pico_multi_receiver*) t->user_data;
+    rx_multi_signal_callback(&(receiver->rx_multi_device), gpio_get_all());
+    return true;
+}
+
+static void pico_multi_rx_set_recurring_trigger_time(uint64_t time_to_trigger, void* user_data)
+{
+    rf_pico_multi_receiver* receiver = (rf_pico_multi_receiver*) user_data;
+    add_repeating_timer_us(time_to_trigger * -1, pico_multi_rx_repeating_timer_callback, user_data, &(receiver->timer));
+}
+
+static void pico_multi_rx_cancel_trigger(void* user_data)
+{
+    rf_pico_multi_receiver* receiver = (rf_pico_multi_receiver*) user_data;
+    cancel_repeating_timer(&(receiver->timer));
+}
+
 static void pico_tx_ready_callback(void* user_data)
 {
   // TODO
@@ -85,13 +176,17 @@ static void pico_tx_ready_callback(void* user_data)
 
 // Callback functions end
 
-void pico_init_transmitter(rf_pico_transmitter* self)
+void pico_init_transmitter(rf_pico_transmitter* self, const RF_Config* config)
 {
     gpio_init(GPIO_PIN);
     gpio_set_dir(GPIO_PIN, GPIO_OUT);
+    memset(&(self->timer), 0, sizeof(repeating_timer_t));
 
     tx_init(&(self->tx_device), pico_tx_set_signal, pico_tx_set_onetime_trigger_time, 
-            pico_tx_set_recurring_trigger_time, pico_tx_cancel_trigger, pico_tx_ready_callback, self);
+            pico_tx_set_recurring_trigger_time, pico_tx_cancel_trigger, pico_tx_ready_callback, self, config);
+    // One alarm per level change instead of a repeating timer per bit
+    tx_set_edge_scheduling(&(self->tx_device), 1);
+    tx_set_timestamp_hook(&(self->tx_device), pico_get_timestamp_us_callback);
 }
 
 void pico_tx_send_message(rf_pico_transmitter* transmitter, RF_Message* message)
@@ -99,34 +194,126 @@ void pico_tx_send_message(rf_pico_transmitter* transmitter, RF_Message* message)
     tx_send_message(&(transmitter->tx_device), message);
 }
 
+void pico_tx_send_bytes(rf_pico_transmitter* transmitter, const uint8_t* data, uint8_t length)
+{
+    tx_send_bytes(&(transmitter->tx_device), data, length);
+}
+
+void pico_rx_set_byte_buffer(rf_pico_receiver* self, uint8_t* buffer, uint8_t size, void* bytes_callback)
+{
+    rx_set_byte_buffer(&(self->rx_device), buffer, size, bytes_callback);
+}
+
+void pico_rx_set_message_queue(rf_pico_receiver* self, RF_Message* buffer, uint8_t size)
+{
+    rx_set_message_queue(&(self->rx_device), buffer, size);
+}
+
+void pico_rx_set_dedup_filter(rf_pico_receiver* self, RX_Dedup_Entry* table, uint8_t size, uint32_t window_us,
+                              uint64_t key_mask)
+{
+    rx_set_dedup_filter(&(self->rx_device), table, size, window_us, key_mask, pico_get_timestamp_us_callback);
+}
+
+void pico_rx_set_message_filter(rf_pico_receiver* self, uint64_t mask, uint64_t value)
+{
+    rx_set_message_filter(&(self->rx_device), mask, value);
+}
+
+bool pico_rx_poll_message(rf_pico_receiver* self, RF_Message* message)
+{
+    return rx_poll_message(&(self->rx_device), message);
+}
+
 void pico_rx_start_receiving(rf_pico_receiver* self)
 {
-    rx_start_receiving(&(self->rx_device));
+    if (self->edge_mode)
+    {
+        rx_start_edge_receiving(&(self->rx_device));
+        pico_gpio_set_irq_handler(self->pin, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, 
+                                  pico_rx_edge_irq_callback, self);
+    }
+    else
+    {
+        rx_start_receiving(&(self->rx_device));
+    }
 }
 
-void pico_init_receiver(rf_pico_receiver* self, void* result_callback)
+void pico_init_receiver(rf_pico_receiver* self, void* result_callback, const RF_Config* config)
 {
-    gpio_init(GPIO_PIN);
-    gpio_set_dir(GPIO_PIN, GPIO_IN);
+    pico_init_receiver_on_pin(self, GPIO_PIN, result_callback, config);
+}
+
+void pico_init_receiver_on_pin(rf_pico_receiver* self, uint8_t pin, void* result_callback, 
+                               const RF_Config* config)
+{
+    gpio_init(pin);
+    gpio_set_dir(pin, GPIO_IN);
 
     rx_init(&(self->rx_device),result_callback, pico_rx_set_recurring_trigger_time, 
-            pico_rx_cancel_trigger, self);
+            pico_rx_cancel_trigger, self, config);
+    rx_set_fractional_timing(&(self->rx_device), pico_rx_set_trigger_period);
+    rx_set_timestamp_hook(&(self->rx_device), pico_get_timestamp_us_callback);
+    self->pin = pin;
+    self->edge_mode = 0;
     
-    Pico_Synchronizer* synchronizer = (Pico_Synchronizer*) malloc(sizeof(Pico_Synchronizer));
-    pico_synchronizer_init(synchronizer);
-    rx_set_external_synchronizer(&(self->rx_device),&(synchronizer->base)); 
+    pico_synchronizer_init(&(self->synchronizer), pin);
+    rx_set_external_synchronizer(&(self->rx_device),&(self->synchronizer.edge_synchronizer.base)); 
+}
+
+void pico_init_edge_receiver(rf_pico_receiver* self, uint8_t pin, void* result_callback, 
+                             const RF_Config* config)
+{
+    gpio_init(pin);
+    gpio_set_dir(pin, GPIO_IN);
+
+    rx_init(&(self->rx_device), result_callback, pico_rx_set_recurring_trigger_time, 
+            pico_rx_cancel_trigger, self, config);
+    rx_set_timestamp_hook(&(self->rx_device), pico_get_timestamp_us_callback);
+    self->pin = pin;
+    self->flush_alarm = 0;
+    self->edge_mode = 1;
 }
 
 void pico_rx_stop_receiving(rf_pico_receiver* self)
 {
+    if (self->edge_mode)
+    {
+        pico_gpio_clear_irq_handler(self->pin, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL);
+        if (self->flush_alarm > 0)
+        {
+            cancel_alarm(self->flush_alarm);
+            self->flush_alarm = 0;
+        }
+    }
+    else
+    {
+        pico_synchronizer_stop(&(self->synchronizer));
+    }
     rx_stop_receiving(&(self->rx_device));    
 }
 
+void pico_init_multi_receiver(rf_pico_multi_receiver* self, const RF_Config* config)
+{
+    rx_multi_init(&(self->rx_multi_device), pico_multi_rx_set_recurring_trigger_time, 
+                  pico_multi_rx_cancel_trigger, self, config);
+}
 
+void pico_multi_rx_add_pin(rf_pico_multi_receiver* self, uint8_t pin, void* result_callback)
+{
+    gpio_init(pin);
+    gpio_set_dir(pin, GPIO_IN);
 
+    // Channel number is the bit of the pin in gpio_get_all()
+    rx_multi_add_channel(&(self->rx_multi_device), pin, result_callback);
+}
 
+void pico_multi_rx_start_receiving(rf_pico_multi_receiver* self)
+{
+    rx_multi_start_receiving(&(self->rx_multi_device));
+}
 
-
-
-
-
+void pico_multi_rx_stop_receiving(rf_pico_multi_receiver* self)
+{
+    rx_multi_stop_receiving(&(self->rx_multi_device));
+}
@@ -3,9 +3,13 @@
 
 #include "pico/stdlib.h"
 #include "rf_device.h"
+#include "rx_multi_device.h"
+#include "pico_synchronizer.h"
 
 #define GPIO_PIN 22
 
+typedef void (*pico_gpio_irq_handler)(void* /*instance*/, uint /*gpio*/, uint32_t /*events*/);
+
 typedef struct 
 {
     TX_Device tx_device;        
@@ -17,17 +21,29 @@ typedef struct
 {
     RX_Device rx_device;
     repeating_timer_t timer;
+    Pico_Synchronizer synchronizer;
+    uint8_t pin;
+    alarm_id_t flush_alarm;     // Edge receiver only
+    uint8_t edge_mode;
 } rf_pico_receiver;
 
+typedef struct 
+{
+    RX_Multi_Device rx_multi_device;
+    repeating_timer_t timer;
+} rf_pico_multi_receiver;
+
 /**
  * @brief Initializes the RF Pico transmitter.
  *
  * This function initializes the RF Pico transmitter by configuring GPIO pins
- * and setting up the transmitter device.
+ * and setting up the transmitter device. The transmitter uses edge scheduling,
+ * one alarm per level change of the frame.
  *
  * @param self Pointer to the RF Pico transmitter structure.
+ * @param config Link timing, or NULL for RF_CONFIG_DEFAULT.
  */
-void pico_init_transmitter(rf_pico_transmitter* self);
+void pico_init_transmitter(rf_pico_transmitter* self, const RF_Config* config);
 
 /**
  * Sends a message using the RF Pico transmitter.
@@ -37,6 +53,15 @@ void pico_init_transmitter(rf_pico_transmitter* self);
  */
 void pico_tx_send_message(rf_pico_transmitter* transmitter, RF_Message* message);
 
+/**
+ * Sends a byte frame using the RF Pico transmitter.
+ *
+ * @param transmitter The RF Pico transmitter.
+ * @param data Payload bytes, must stay valid until the frame is sent.
+ * @param length Number of payload bytes.
+ */
+void pico_tx_send_bytes(rf_pico_transmitter* transmitter, const uint8_t* data, uint8_t length);
+
 /**
  * @brief Initializes the RF Pico receiver.
  *
@@ -45,8 +70,94 @@ void pico_tx_send_message(rf_pico_transmitter* transmitter, RF_Message* message)
  *
  * @param self Pointer to the RF Pico receiver structure.
  * @param result_callback Pointer to the callback function for receiving results.
+ * @param config Link timing, or NULL for RF_CONFIG_DEFAULT. The bit time is detected by the
+ *               synchronizer, the rest of the config applies.
+ */
+void pico_init_receiver(rf_pico_receiver* self, void* result_callback, const RF_Config* config);
+
+/**
+ * @brief Initializes an RF Pico receiver on the given pin.
+ *
+ * Same as pico_init_receiver, but for any pin. Each receiver has its own synchronizer, so several
+ * receivers can run at the same time on different pins.
+ *
+ * @param self Pointer to the RF Pico receiver structure.
+ * @param pin GPIO pin of the receiver.
+ * @param result_callback Pointer to the callback function for receiving results.
+ * @param config Link timing, or NULL for RF_CONFIG_DEFAULT.
+ */
+void pico_init_receiver_on_pin(rf_pico_receiver* self, uint8_t pin, void* result_callback, 
+                               const RF_Config* config);
+
+/**
+ * @brief Initializes the RF Pico receiver in edge mode.
+ *
+ * Instead of sampling the pin sampling_count times per bit, the receiver takes a GPIO interrupt
+ * on every edge and decodes bits from the edge timestamps. Uses the static synchronization.
+ *
+ * @param self Pointer to the RF Pico receiver structure.
+ * @param pin GPIO pin of the receiver.
+ * @param result_callback Pointer to the callback function for receiving results.
+ * @param config Link timing, or NULL for RF_CONFIG_DEFAULT. The bit time must match the transmitter.
+ */
+void pico_init_edge_receiver(rf_pico_receiver* self, uint8_t pin, void* result_callback, 
+                             const RF_Config* config);
+
+/**
+ * @brief Enables receiving byte frames with the RF Pico receiver.
+ *
+ * @param self Pointer to the RF Pico receiver structure.
+ * @param buffer Buffer the payload is received to.
+ * @param size Size of the buffer in bytes.
+ * @param bytes_callback Pointer to the callback function for receiving byte frames.
+ */
+void pico_rx_set_byte_buffer(rf_pico_receiver* self, uint8_t* buffer, uint8_t size, void* bytes_callback);
+
+/**
+ * @brief Enables queueing of received messages with the RF Pico receiver.
+ *
+ * Messages are taken out with pico_rx_poll_message instead of the result callback, so the
+ * application does not run in the timer interrupt.
+ *
+ * @param self Pointer to the RF Pico receiver structure.
+ * @param buffer Storage for the queue.
+ * @param size Number of entries in the buffer, a power of two.
+ */
+void pico_rx_set_message_queue(rf_pico_receiver* self, RF_Message* buffer, uint8_t size);
+
+/**
+ * @brief Enables dropping repeated copies of a frame with the RF Pico receiver.
+ *
+ * See rx_set_dedup_filter, the window is measured with the microsecond timer.
+ *
+ * @param self Pointer to the RF Pico receiver structure.
+ * @param table Storage for the table of recent frames, or NULL to disable the filter.
+ * @param size Number of entries in the table, a power of two.
+ * @param window_us Copies within this many microseconds of the first one are dropped.
+ * @param key_mask Message bits forming the key, 0 for the whole frame and CRC.
+ */
+void pico_rx_set_dedup_filter(rf_pico_receiver* self, RX_Dedup_Entry* table, uint8_t size, uint32_t window_us,
+                              uint64_t key_mask);
+
+/**
+ * @brief Enables dropping messages for other receivers with the RF Pico receiver.
+ *
+ * See rx_set_message_filter.
+ *
+ * @param self Pointer to the RF Pico receiver structure.
+ * @param mask Message bits to check, 0 to receive every message.
+ * @param value Required value of the bits under mask.
+ */
+void pico_rx_set_message_filter(rf_pico_receiver* self, uint64_t mask, uint64_t value);
+
+/**
+ * @brief Takes the oldest received message from the queue of the RF Pico receiver.
+ *
+ * @param self Pointer to the RF Pico receiver structure.
+ * @param message The message is copied here.
+ * @return true if a message was taken, false if the queue is empty.
  */
-void pico_init_receiver(rf_pico_receiver* self, void* result_callback);
+bool pico_rx_poll_message(rf_pico_receiver* self, RF_Message* message);
 
 /**
  * @brief Starts receiving data using the RF Pico receiver.
@@ -66,4 +177,58 @@ void pico_rx_start_receiving(rf_pico_receiver* self);
  */
 void pico_rx_stop_receiving(rf_pico_receiver* self);
 
+/**
+ * @brief Initializes the RF Pico multi-channel receiver.
+ *
+ * One repeating timer samples the whole GPIO bank and decodes all added pins at once.
+ *
+ * @param self Pointer to the RF Pico multi-channel receiver structure.
+ * @param config Link timing of all pins, or NULL for RF_CONFIG_DEFAULT.
+ */
+void pico_init_multi_receiver(rf_pico_multi_receiver* self, const RF_Config* config);
+
+/**
+ * @brief Adds a receiver pin to the RF Pico multi-channel receiver.
+ *
+ * @param self Pointer to the RF Pico multi-channel receiver structure.
+ * @param pin GPIO pin of the receiver.
+ * @param result_callback Pointer to the callback function for the frames received on this pin.
+ */
+void pico_multi_rx_add_pin(rf_pico_multi_receiver* self, uint8_t pin, void* result_callback);
+
+/**
+ * @brief Starts receiving data on all pins of the RF Pico multi-channel receiver.
+ *
+ * @param self Pointer to the RF Pico multi-channel receiver structure.
+ */
+void pico_multi_rx_start_receiving(rf_pico_multi_receiver* self);
+
+/**
+ * @brief Stops receiving data on all pins of the RF Pico multi-channel receiver.
+ *
+ * @param self Pointer to the RF Pico multi-channel receiver structure.
+ */
+void pico_multi_rx_stop_receiving(rf_pico_multi_receiver* self);
+
+/**
+ * @brief Sets the GPIO interrupt handler of a pin.
+ *
+ * All pins share one GPIO interrupt callback that dispatches to the handler registered for the
+ * pin, so receivers on different pins do not replace each other's callbacks.
+ *
+ * @param pin GPIO pin.
+ * @param events GPIO_IRQ_* events to enable for the pin.
+ * @param handler Handler to call for the events of the pin.
+ * @param instance Instance passed to the handler.
+ */
+void pico_gpio_set_irq_handler(uint8_t pin, uint32_t events, pico_gpio_irq_handler handler, void* instance);
+
+/**
+ * @brief Disables the given GPIO interrupt events of a pin and removes its handler.
+ *
+ * @param pin GPIO pin.
+ * @param events GPIO_IRQ_* events to disable for the pin.
+ */
+void pico_gpio_clear_irq_handler(uint8_t pin, uint32_t events);
+
 #endif // RF_PICO_H
@@ -0,0 +1,206 @@
+#include <string.h>
+
+#include "rf_capture.h"
+
+static const uint8_t capture_magic[4] = { 'P', 'R', 'F', 'C' };
+
+// Makes room for one record, returns 0 if the record must be dropped
+static uint8_t rf_capture_reserve(RF_Capture* self, size_t length)
+{
+    if (self->full)
+    {
+        self->dropped_count += 1;
+        return 0;
+    }
+    if (self->length + length <= self->size)
+    {
+        return 1;
+    }
+    if (!self->flush)
+    {
+        // Stop here, the records after a gap could not be replayed
+        self->full = 1;
+        self->dropped_count += 1;
+        return 0;
+    }
+    self->flush(self->buffer, self->length, self->user_data);
+    self->length = 0;
+    return 1;
+}
+
+static void rf_capture_write_record(RF_Capture* self, uint64_t value)
+{
+    if (!rf_capture_reserve(self, RF_CAPTURE_MAX_RECORD))
+    {
+        return;
+    }
+    uint8_t* const out = self->buffer;
+    while (value >= 0x80)
+    {
+        out[self->length++] = (uint8_t) value | 0x80;
+        value >>= 7;
+    }
+    out[self->length++] = (uint8_t) value;
+}
+
+void rf_capture_init(RF_Capture* self, RF_Capture_Kind kind, uint8_t* buffer, size_t size,
+                     void* flush, void* user_data)
+{
+    memset(self, 0, sizeof(RF_Capture));
+    self->kind = kind;
+    self->buffer = buffer;
+    self->size = size;
+    self->flush = flush;
+    self->user_data = user_data;
+}
+
+void rf_capture_begin(RF_Capture* self, const RF_Config* config, RF_Line_Coding coding, uint8_t flags)
+{
+    if (!rf_capture_reserve(self, RF_CAPTURE_HEADER_SIZE))
+    {
+        return;
+    }
+    uint8_t* const out = &(self->buffer[self->length]);
+    memset(out, 0, RF_CAPTURE_HEADER_SIZE);
+    memcpy(out, capture_magic, sizeof(capture_magic));
+    out[4] = RF_CAPTURE_VERSION;
+    out[5] = self->kind;
+    out[6] = coding;
+    out[7] = flags;
+    out[8] = config->bit_time & 0xFF;
+    out[9] = config->bit_time >> 8;
+    out[10] = config->wakeup_time & 0xFF;
+    out[11] = config->wakeup_time >> 8;
+    out[12] = config->sampling_count;
+    out[13] = config->sampling_tolerance;
+    out[14] = config->sync_symbol_length;
+    out[15] = config->frame_gap;
+    out[16] = config->sync_tolerance;
+    self->length += RF_CAPTURE_HEADER_SIZE;
+    self->run_length = 0;
+    self->last_timestamp = 0;
+}
+
+void rf_capture_sample(RF_Capture* self, uint8_t level)
+{
+    level = level ? 1 : 0;
+    if (level == self->level && self->run_length != UINT32_MAX)
+    {
+        self->run_length += 1;
+        return;
+    }
+    if (self->run_length)
+    {
+        rf_capture_write_record(self, ((uint64_t) self->run_length << 1) | self->level);
+    }
+    self->level = level;
+    self->run_length = 1;
+}
+
+void rf_capture_packed(RF_Capture* self, const uint32_t* packed, size_t nbits)
+{
+    size_t pos = 0;
+    while (pos < nbits)
+    {
+        uint32_t const word = packed[pos >> 5];
+        if (!(pos & 31) && nbits - pos >= 32 && self->run_length &&
+            word == (self->level ? 0xFFFFFFFFUL : 0) && self->run_length <= UINT32_MAX - 32)
+        {
+            // Whole word continuing the run
+            self->run_length += 32;
+            pos += 32;
+            continue;
+        }
+        rf_capture_sample(self, (word >> (pos & 31)) & 1);
+        pos += 1;
+    }
+}
+
+void rf_capture_edge(RF_Capture* self, uint32_t timestamp_us, uint8_t level)
+{
+    uint32_t const delta = timestamp_us - self->last_timestamp;
+    self->last_timestamp = timestamp_us;
+    rf_capture_write_record(self, ((uint64_t) delta << 2) | (level ? 1 : 0));
+}
+
+void rf_capture_edge_flush(RF_Capture* self, uint32_t timestamp_us)
+{
+    uint32_t const delta = timestamp_us - self->last_timestamp;
+    self->last_timestamp = timestamp_us;
+    rf_capture_write_record(self, ((uint64_t) delta << 2) | 2);
+}
+
+void rf_capture_finish(RF_Capture* self)
+{
+    if (self->run_length)
+    {
+        rf_capture_write_record(self, ((uint64_t) self->run_length << 1) | self->level);
+        self->run_length = 0;
+    }
+    if (self->flush && self->length)
+    {
+        self->flush(self->buffer, self->length, self->user_data);
+        self->length = 0;
+    }
+}
+
+int8_t rf_capture_open(RF_Capture_Reader* self, const uint8_t* data, size_t length)
+{
+    memset(self, 0, sizeof(RF_Capture_Reader));
+    if (length < RF_CAPTURE_HEADER_SIZE || memcmp(data, capture_magic, sizeof(capture_magic)) ||
+        data[4] != RF_CAPTURE_VERSION || data[5] > RF_CAPTURE_EDGES)
+    {
+        return -1;
+    }
+    self->data = data;
+    self->length = length;
+    self->position = RF_CAPTURE_HEADER_SIZE;
+    self->header.kind = data[5];
+    self->header.line_coding = data[6];
+    self->header.flags = data[7];
+    self->header.config.bit_time = data[8] | (data[9] << 8);
+    self->header.config.wakeup_time = data[10] | (data[11] << 8);
+    self->header.config.sampling_count = data[12];
+    self->header.config.sampling_tolerance = data[13];
+    self->header.config.sync_symbol_length = data[14];
+    self->header.config.frame_gap = data[15];
+    self->header.config.sync_tolerance = data[16];
+    return 0;
+}
+
+uint8_t rf_capture_read(RF_Capture_Reader* self, RF_Capture_Record* record)
+{
+    uint64_t value = 0;
+    uint8_t shift = 0;
+    size_t position = self->position;
+    while (1)
+    {
+        if (position >= self->length || shift >= 7 * RF_CAPTURE_MAX_RECORD)
+        {
+            return 0;
+        }
+        uint8_t const byte = self->data[position++];
+        value |= (uint64_t) (byte & 0x7F) << shift;
+        shift += 7;
+        if (!(byte & 0x80))
+        {
+            break;
+        }
+    }
+    self->position = position;
+
+    if (self->header.kind == RF_CAPTURE_SAMPLES)
+    {
+        record->type = RF_CAPTURE_RUN;
+        record->level = value & 1;
+        record->value = (uint32_t) (value >> 1);
+    }
+    else
+    {
+        self->timestamp += (uint32_t) (value >> 2);
+        record->type = (value & 2) ? RF_CAPTURE_FLUSH : RF_CAPTURE_EDGE;
+        record->level = value & 1;
+        record->value = self->timestamp;
+    }
+    return 1;
+}
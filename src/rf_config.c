@@ -0,0 +1,48 @@
+#include <stdint.h>
+
+#include "rf_device.h"
+
+uint8_t rf_config_clamp(RF_Config* config)
+{
+    RF_Config const original = *config;
+
+    // Even number of samples, two of them at the bit edges
+    config->sampling_count &= ~1U;
+    if (config->sampling_count < RF_MIN_SAMPLING_COUNT)
+    {
+        config->sampling_count = RF_MIN_SAMPLING_COUNT;
+    }
+    else if (config->sampling_count > MAX_SAMPLING_COUNT)
+    {
+        config->sampling_count = MAX_SAMPLING_COUNT;
+    }
+    // A bit needs a majority of the mid-bit samples, otherwise both levels would pass
+    uint8_t const max_tolerance = (config->sampling_count - 2) / 2 - 1;
+    if (config->sampling_tolerance > max_tolerance)
+    {
+        config->sampling_tolerance = max_tolerance;
+    }
+    if (config->bit_time < config->sampling_count)
+    {
+        config->bit_time = config->sampling_count;
+    }
+    config->sync_symbol_length &= ~1U;
+    if (config->sync_symbol_length < RF_MIN_SYNC_SYMBOL_LENGTH)
+    {
+        config->sync_symbol_length = RF_MIN_SYNC_SYMBOL_LENGTH;
+    }
+    else if (config->sync_symbol_length > SYNC_SYMBOL_LENGTH)
+    {
+        config->sync_symbol_length = SYNC_SYMBOL_LENGTH;
+    }
+    if (config->frame_gap > config->sync_symbol_length)
+    {
+        config->frame_gap = config->sync_symbol_length;
+    }
+
+    return original.bit_time != config->bit_time ||
+           original.sampling_count != config->sampling_count ||
+           original.sampling_tolerance != config->sampling_tolerance ||
+           original.sync_symbol_length != config->sync_symbol_length ||
+           original.frame_gap != config->frame_gap;
+}
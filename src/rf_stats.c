@@ -0,0 +1,31 @@
+#include <string.h>
+#include <stdint.h>
+
+#include "rf_device.h"
+
+void rf_isr_stats_reset(RF_ISR_Stats* stats)
+{
+    memset(stats, 0, sizeof(RF_ISR_Stats));
+    stats->min = UINT32_MAX;
+}
+
+void rf_isr_stats_add(RF_ISR_Stats* stats, uint32_t duration)
+{
+    stats->count += 1;
+    stats->total += duration;
+    if (duration < stats->min)
+    {
+        stats->min = duration;
+    }
+    if (duration > stats->max)
+    {
+        stats->max = duration;
+    }
+    // Bin by the bit length of the duration
+    uint8_t bin = duration ? 32 - __builtin_clz(duration) : 0;
+    if (bin >= RF_STATS_HISTOGRAM_BINS)
+    {
+        bin = RF_STATS_HISTOGRAM_BINS - 1;
+    }
+    stats->histogram[bin] += 1;
+}
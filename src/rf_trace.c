@@ -0,0 +1,157 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "rf_trace.h"
+
+#if defined(USING_PICO) || defined(USING_PICO_W)
+#include "hardware/sync.h"
+#endif
+
+typedef struct
+{
+    RF_Trace_Record* buffer;
+    uint32_t    mask;                   // Size of the ring - 1
+    uint32_t    head;                   // Next index to write, reserved by the writers (free running)
+    uint32_t    tail;                   // Next index to read, reader only (free running)
+    uint32_t    lost_count;
+    uint32_t (*get_timestamp)(void* /*user_data*/);
+    void*       user_data;
+} RF_Tracer;
+
+static RF_Tracer tracer;
+
+static const char* const trace_event_names[] =
+{
+    "?", "rx state", "rx sync loss", "rx frame", "tx state", "sync outliers", "sync rate",
+    "rx duplicate"
+};
+
+void rf_trace_init(RF_Trace_Record* buffer, uint16_t size, void* get_timestamp, void* user_data)
+{
+    __atomic_store_n(&(tracer.buffer), NULL, __ATOMIC_SEQ_CST);
+    if (!buffer || !size)
+    {
+        return;
+    }
+    memset(buffer, 0, size * sizeof(RF_Trace_Record));
+    tracer.mask = size - 1;
+    tracer.head = 0;
+    tracer.tail = 0;
+    tracer.lost_count = 0;
+    tracer.get_timestamp = get_timestamp;
+    tracer.user_data = user_data;
+    __atomic_store_n(&(tracer.buffer), buffer, __ATOMIC_SEQ_CST);
+}
+
+// Reserves the index of the next record. The Cortex-M0+ has no atomic read-modify-write, a
+// fetch_add would become a libatomic call there, so the interrupts are held off instead.
+static inline uint32_t rf_trace_reserve(void)
+{
+#if defined(USING_PICO) || defined(USING_PICO_W)
+    uint32_t const interrupts = save_and_disable_interrupts();
+    uint32_t const index = tracer.head;
+    __atomic_store_n(&(tracer.head), index + 1, __ATOMIC_RELAXED);
+    restore_interrupts(interrupts);
+    return index;
+#else
+    return __atomic_fetch_add(&(tracer.head), 1, __ATOMIC_RELAXED);
+#endif
+}
+
+void rf_trace(uint8_t event, uint16_t arg)
+{
+    RF_Trace_Record* const buffer = __atomic_load_n(&(tracer.buffer), __ATOMIC_ACQUIRE);
+    if (!buffer)
+    {
+        return;
+    }
+    uint32_t const index = rf_trace_reserve();
+    RF_Trace_Record* const record = &(buffer[index & tracer.mask]);
+
+    // Mark the record incomplete before touching it, the reader checks the sequence on both sides
+    __atomic_store_n(&(record->sequence), 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    record->timestamp = tracer.get_timestamp ? tracer.get_timestamp(tracer.user_data) : 0;
+    record->arg = arg;
+    record->event = event;
+    __atomic_store_n(&(record->sequence), index + 1, __ATOMIC_RELEASE);
+}
+
+uint8_t rf_trace_read(RF_Trace_Record* record)
+{
+    RF_Trace_Record* const buffer = tracer.buffer;
+    if (!buffer)
+    {
+        return 0;
+    }
+    while (1)
+    {
+        uint32_t const head = __atomic_load_n(&(tracer.head), __ATOMIC_ACQUIRE);
+        uint32_t const tail = tracer.tail;
+        if (head == tail)
+        {
+            return 0;
+        }
+        if (head - tail > tracer.mask + 1)
+        {
+            // The writers went around, skip to the oldest record still in the ring
+            tracer.lost_count += head - tail - (tracer.mask + 1);
+            tracer.tail = head - (tracer.mask + 1);
+            continue;
+        }
+
+        RF_Trace_Record const* const slot = &(buffer[tail & tracer.mask]);
+        uint32_t const sequence = __atomic_load_n(&(slot->sequence), __ATOMIC_ACQUIRE);
+        if (sequence != tail + 1)
+        {
+            if (sequence == 0 || sequence - (tail + 1) > 0x80000000UL)
+            {
+                // Reserved but not written yet
+                return 0;
+            }
+            // Overwritten by a newer record, the head shows how far
+            continue;
+        }
+        record->timestamp = slot->timestamp;
+        record->arg = slot->arg;
+        record->event = slot->event;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&(slot->sequence), __ATOMIC_RELAXED) != sequence)
+        {
+            // Overwritten while copying
+            continue;
+        }
+        record->sequence = sequence;
+        tracer.tail = tail + 1;
+        return 1;
+    }
+}
+
+uint32_t rf_trace_lost_count(void)
+{
+    return tracer.lost_count;
+}
+
+const char* rf_trace_event_name(uint8_t event)
+{
+    if (event >= RF_TRACE_USER)
+    {
+        return "user";
+    }
+    if (event >= sizeof(trace_event_names) / sizeof(trace_event_names[0]))
+    {
+        return trace_event_names[0];
+    }
+    return trace_event_names[event];
+}
+
+int rf_trace_format(const RF_Trace_Record* record, char* text, size_t size)
+{
+    if (record->event >= RF_TRACE_USER)
+    {
+        return snprintf(text, size, "%10lu user %u: %u", (unsigned long) record->timestamp,
+                        record->event - RF_TRACE_USER, record->arg);
+    }
+    return snprintf(text, size, "%10lu %s: %u", (unsigned long) record->timestamp,
+                    rf_trace_event_name(record->event), record->arg);
+}
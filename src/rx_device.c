@@ -8,31 +8,58 @@
 
 #include <stdlib.h>
 #include <string.h>
-#include <math.h>
 #include "debug_logging.h"
 #include "rf_device.h"
+#include "rf_capture.h"
 
 #include <stdio.h>
 
 static void rx_set_state(RX_Device* self, RX_State state);
 
+// Nibble for each 6-bit 4b6b symbol (RH_ASK symbol table), 0xFF for invalid symbols
+static const uint8_t rx_4b6b_nibbles[64] = 
+{
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x01, 0xFF,
+    0xFF, 0xFF, 0xFF, 0x02, 0xFF, 0x03, 0x04, 0xFF, 0xFF, 0x05, 0x06, 0xFF, 0x07, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0x08, 0xFF, 0x09, 0x0A, 0xFF, 0xFF, 0x0B, 0x0C, 0xFF, 0x0D, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0x0E, 0xFF, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+};
+
+// Hamming(7,4) codewords for nibbles 0 - 15, same table as the TX
+static const uint8_t rx_hamming74_codewords[16] = 
+{
+    0x04, 0x0F, 0x11, 0x1A, 0x22, 0x29, 0x37, 0x3C,
+    0x43, 0x48, 0x56, 0x5D, 0x65, 0x6E, 0x70, 0x7B
+};
+
 void rx_init(   RX_Device* self,
                 void* result_callback,
                 void* set_recurring_trigger_time, 
                 void* cancel_trigger,
-                void* user_data)
+                void* user_data,
+                const RF_Config* config)
 {
+    static const RF_Config default_config = RF_CONFIG_DEFAULT;
+
     memset(self, 0, sizeof(RX_Device));
+    self->config = config ? *config : default_config;
+    rf_config_clamp(&(self->config));
 
     // Set functions
     self->result_callback = result_callback;
     self->set_recurring_trigger_time = set_recurring_trigger_time;
     self->cancel_trigger = cancel_trigger;
     self->user_data = user_data;
+    self->sync_rate = self->config.bit_time;
+    self->sync_best_distance = RX_SYNC_NO_CANDIDATE;
+#ifdef ENABLE_ISR_STATS
+    rf_isr_stats_reset(&(self->stats.isr));
+#endif
     
     // Prepare sync data
     uint8_t start_sync_pattern = SYNC_SYMBOL >> (SYNC_SYMBOL_LENGTH - 4); // Get 4 highest bits
-    uint8_t sync_pattern_length = SAMPLING_COUNT * 4;
+    uint8_t const sampling_count = self->config.sampling_count;
+    uint8_t sync_pattern_length = sampling_count * 4;
     uint16_t bitmask = (start_sync_pattern >> 3) & 0x1; // Use 4th bit as the mask
     for (int i = 0; i < sync_pattern_length; i++)
     {
@@ -44,7 +71,7 @@ void rx_init(   RX_Device* self,
             self->sync_pattern_mask <<= 1;
         }
 
-        if (!((i + 1) % SAMPLING_COUNT))
+        if (!((i + 1) % sampling_count))
         {
             start_sync_pattern <<= 1;
             bitmask = (start_sync_pattern >> 3) & 0x1;
@@ -52,18 +79,194 @@ void rx_init(   RX_Device* self,
     }
 }
 
+void rx_set_line_coding(RX_Device* self, RF_Line_Coding coding)
+{
+    self->line_coding = coding;
+}
+
+void rx_set_byte_buffer(RX_Device* self, uint8_t* buffer, uint8_t size, void* bytes_callback)
+{
+    self->byte_buffer = buffer;
+    self->byte_buffer_size = size;
+    self->bytes_callback = bytes_callback;
+}
+
+void rx_set_message_queue(RX_Device* self, RF_Message* buffer, uint8_t size)
+{
+    self->message_queue_mask = size - 1;
+    self->message_queue_head = 0;
+    self->message_queue_tail = 0;
+    self->message_queue_overflow_count = 0;
+    self->message_queue = buffer;
+}
+
+uint8_t rx_poll_message(RX_Device* self, RF_Message* message)
+{
+    uint8_t const tail = self->message_queue_tail;
+    if (__atomic_load_n(&(self->message_queue_head), __ATOMIC_ACQUIRE) == tail)
+    {
+        return 0;
+    }
+    *message = self->message_queue[tail & self->message_queue_mask];
+    // Hand the entry back to the receiver only after it is copied
+    __atomic_store_n(&(self->message_queue_tail), (uint8_t) (tail + 1), __ATOMIC_RELEASE);
+    return 1;
+}
+
+// Called by the receiver only
+static void rx_queue_message(RX_Device* self)
+{
+    uint8_t const head = self->message_queue_head;
+    uint8_t const tail = __atomic_load_n(&(self->message_queue_tail), __ATOMIC_ACQUIRE);
+    if ((uint8_t) (head - tail) > self->message_queue_mask)
+    {
+        // Full, drop the new message
+        self->message_queue_overflow_count += 1;
+        return;
+    }
+    self->message_queue[head & self->message_queue_mask] = self->message;
+    // Publish the entry only after it is written
+    __atomic_store_n(&(self->message_queue_head), (uint8_t) (head + 1), __ATOMIC_RELEASE);
+}
+
+void rx_set_fractional_timing(RX_Device* self, void* set_trigger_period)
+{
+    self->set_trigger_period = set_trigger_period;
+}
+
+// Starts the sample trigger. Deadlines are rounded to the nearest us, so the phase starts at a half.
+static void rx_start_sample_clock(RX_Device* self, uint32_t sample_period)
+{
+    uint32_t const deadline = sample_period + (1UL << (RX_PERIOD_FRACTION_BITS - 1));
+    self->sample_period = sample_period;
+    self->sample_phase = deadline & ((1UL << RX_PERIOD_FRACTION_BITS) - 1);
+    self->trigger_period = deadline >> RX_PERIOD_FRACTION_BITS;
+    self->set_recurring_trigger_time(self->trigger_period, self->user_data);
+}
+
+// Sets the interval to the next sample from the phase accumulator
+static inline void rx_advance_sample_clock(RX_Device* self)
+{
+    if (!self->set_trigger_period)
+    {
+        return;
+    }
+    uint32_t const deadline = self->sample_phase + self->sample_period;
+    uint32_t const period = deadline >> RX_PERIOD_FRACTION_BITS;
+    self->sample_phase = deadline & ((1UL << RX_PERIOD_FRACTION_BITS) - 1);
+    if (period != self->trigger_period)
+    {
+        self->trigger_period = period;
+        self->set_trigger_period(period, self->user_data);
+    }
+}
+
+void rx_set_phase_tracking(RX_Device* self, uint8_t enabled)
+{
+    self->phase_tracking = enabled;
+}
+
+void rx_set_crc_repair(RX_Device* self, uint8_t enabled)
+{
+    self->crc_repair = enabled;
+}
+
+void rx_set_dedup_filter(RX_Device* self, RX_Dedup_Entry* table, uint8_t size, uint32_t window,
+                         uint64_t key_mask, void* get_time)
+{
+    if (table)
+    {
+        memset(table, 0, size * sizeof(RX_Dedup_Entry));
+    }
+    self->dedup_mask = size - 1;
+    self->dedup_window = window;
+    self->dedup_key_mask = key_mask;
+    self->get_dedup_time = get_time;
+    self->dedup_table = table;
+}
+
+void rx_set_message_filter(RX_Device* self, uint64_t mask, uint64_t value)
+{
+    self->filter_mask = mask;
+    self->filter_value = value & mask;
+    self->filter_shift = mask ? __builtin_ctzll(mask) : 0;
+    self->filter_length = mask ? 64 - __builtin_clzll(mask) : 0;
+}
+
+void rx_set_timestamp_hook(RX_Device* self, void* get_timestamp)
+{
+#ifdef ENABLE_ISR_STATS
+    self->get_timestamp = get_timestamp;
+#endif
+}
+
+void rx_set_capture(RX_Device* self, RF_Capture* capture)
+{
+    if (capture)
+    {
+        rf_capture_begin(capture, &(self->config), self->line_coding,
+                         (self->phase_tracking ? RF_CAPTURE_PHASE_TRACKING : 0) |
+                         (self->crc_repair ? RF_CAPTURE_CRC_REPAIR : 0));
+    }
+    self->capture = capture;
+}
+
+void rx_reset_stats(RX_Device* self)
+{
+    memset(&(self->stats), 0, sizeof(RX_Stats));
+#ifdef ENABLE_ISR_STATS
+    rf_isr_stats_reset(&(self->stats.isr));
+#endif
+}
+
+static inline uint32_t rx_isr_begin(RX_Device* self)
+{
+#ifdef ENABLE_ISR_STATS
+    return self->get_timestamp ? self->get_timestamp(self->user_data) : 0;
+#else
+    return 0;
+#endif
+}
+
+static inline void rx_isr_end(RX_Device* self, uint32_t start)
+{
+#ifdef ENABLE_ISR_STATS
+    if (self->get_timestamp)
+    {
+        rf_isr_stats_add(&(self->stats.isr), self->get_timestamp(self->user_data) - start);
+    }
+#endif
+}
+
 void rx_set_external_synchronizer(RX_Device* self, RX_Synchronizer* synchronizer)
 {
     self->ext_synchronizer = synchronizer;
 }
 
 void rx_set_detected_transmission_rate(RX_Device* self, float rate, uint8_t signal_status)
+{
+    rx_set_detected_bit_period(self, (uint32_t) (rate * (1UL << RX_PERIOD_FRACTION_BITS) + 0.5f), signal_status);
+}
+
+void rx_set_detected_bit_period(RX_Device* self, uint32_t bit_period, uint8_t signal_status)
 {
     // Adjust the recurring trigger time based on the detected transmission rate
+    uint8_t const sampling_count = self->config.sampling_count;
+    uint32_t const sample_period = (bit_period + sampling_count / 2) / sampling_count;
    
-    uint16_t sync_rate = round((float) rate / SAMPLING_COUNT);
-    self->set_recurring_trigger_time(sync_rate, self->user_data);
+    self->sync_rate = (bit_period + (1UL << (RX_PERIOD_FRACTION_BITS - 1))) >> RX_PERIOD_FRACTION_BITS;
+    if (self->set_trigger_period)
+    {
+        rx_start_sample_clock(self, sample_period);
+    }
+    else
+    {
+        // Whole us only
+        uint32_t const sample_rate = (sample_period + (1UL << (RX_PERIOD_FRACTION_BITS - 1))) >> RX_PERIOD_FRACTION_BITS;
+        rx_start_sample_clock(self, sample_rate << RX_PERIOD_FRACTION_BITS);
+    }
     rx_set_state(self, RX_WAIT_START);
+    self->signal_state = signal_status;
     
     if (signal_status)
     {
@@ -76,8 +279,13 @@ void rx_set_detected_transmission_rate(RX_Device* self, float rate, uint8_t sign
     self->rx_bit.sync_index = 1;
 }
 
-static inline void rx_return_to_sync(RX_Device* self)
+static inline void rx_return_to_sync(RX_Device* self, RX_Sync_Loss reason)
 {
+    if (self->state != RX_SYNC)
+    {
+        self->stats.sync_losses[reason] += 1;
+        TRACE(RF_TRACE_RX_SYNC_LOSS, reason);
+    }
     if (self->ext_synchronizer)
     {
         self->cancel_trigger(self->user_data);
@@ -85,9 +293,90 @@ static inline void rx_return_to_sync(RX_Device* self)
     rx_set_state(self, RX_SYNC);
 }
 
-static int rx_do_sampling(RX_Device* self)
+// Returns 1 if a bit without a clear majority is taken as a guess instead of losing the frame:
+// the Hamming decoder weighs it by its confidence, and the CRC repair may flip it.
+static inline uint8_t rx_guesses_bits(RX_Device* self)
 {
-    if (self->rx_bit.sync_index > 0 && self->rx_bit.sync_index < (SAMPLING_COUNT - 1)) // Skip the first and last slot
+    if (self->line_coding == RF_LINE_CODING_HAMMING74)
+    {
+        return self->state >= RX_READ_LENGTH;
+    }
+    // The repair does not cover the length field
+    return self->crc_repair && self->line_coding == RF_LINE_CODING_NRZ && self->state > RX_READ_LENGTH;
+}
+
+// Decides the bit from the sample counts collected over the mid-bit slots
+static int rx_decide_bit(RX_Device* self)
+{
+    uint8_t const low = self->rx_bit.low_sample_count;
+    uint8_t const high = self->rx_bit.high_sample_count;
+    self->rx_bit.sync_index = 0;
+    self->rx_bit.low_sample_count = 0;
+    self->rx_bit.high_sample_count = 0;
+    self->rx_bit.confidence = high > low ? high - low : low - high;
+    // Determine how many same samples we need to identify the bit
+    uint8_t neededCount = self->config.sampling_count - self->config.sampling_tolerance - 2;
+
+    if (low >= neededCount)  
+    {
+        self->rx_bit.latest_bit = 0;
+        // We have a bit
+        return 1;
+    }
+    else if (high >= neededCount) 
+    {
+        self->rx_bit.latest_bit = 1;
+        // We have a bit
+        return 1;
+    }
+    else if (rx_guesses_bits(self))
+    {
+        // Guess with the confidence of the majority
+        self->rx_bit.latest_bit = high > low;
+        return 1;
+    }
+    else
+    {
+        // Not enough proper samples found -> error in data.
+        // No bit
+        return -1;
+    }
+}
+
+// Returns 1 if the sampling window should move one slot earlier. Moves it one slot later itself.
+static inline uint8_t rx_track_phase(RX_Device* self, uint8_t previous_state)
+{
+    uint8_t const index = self->rx_bit.sync_index;
+    if (!self->phase_tracking || self->signal_state == previous_state || !index)
+    {
+        return 0;
+    }
+    if (index < self->config.sampling_count / 2)
+    {
+        // Transition after the window start, the transmitter is slower. Take this sample again.
+        self->rx_bit.sync_index -= 1;
+        return 0;
+    }
+    // Transition before the window end, the transmitter is faster
+    return 1;
+}
+
+static int rx_do_sampling(RX_Device* self, uint8_t previous_state)
+{
+    uint8_t const last_slot = self->config.sampling_count - 1;
+    if (rx_track_phase(self, previous_state))
+    {
+        if (self->rx_bit.sync_index == last_slot)
+        {
+            // This sample is the first slot of the next bit already
+            int const res = rx_decide_bit(self);
+            self->rx_bit.sync_index = 1;
+            return res;
+        }
+        // Skip a slot
+        self->rx_bit.sync_index += 1;
+    }
+    if (self->rx_bit.sync_index > 0 && self->rx_bit.sync_index < last_slot) // Skip the first and last slot
     {       
         // Get a sample
         if (self->signal_state == 0)
@@ -99,50 +388,61 @@ static int rx_do_sampling(RX_Device* self)
             self->rx_bit.high_sample_count += 1;
         }  
     }
-    else if (self->rx_bit.sync_index == (SAMPLING_COUNT - 1)) 
+    else if (self->rx_bit.sync_index == last_slot) 
     {
-        self->rx_bit.sync_index = 0;
-        // Determine how many same samples we need to identify the bit
-        uint8_t neededCount = SAMPLING_COUNT - SAMPLING_TOLERANCE - 2;
-
-        if (self->rx_bit.low_sample_count >= neededCount)  
-        {
-            self->rx_bit.latest_bit = 0;
-            self->rx_bit.low_sample_count = 0;
-            self->rx_bit.high_sample_count = 0;
-            // We have a bit
-            return 1;
-        }
-        else if (self->rx_bit.high_sample_count >= neededCount) 
-        {
-            self->rx_bit.latest_bit = 1;
-            self->rx_bit.low_sample_count = 0;
-            self->rx_bit.high_sample_count = 0;
-            // We have a bit
-            return 1;
-        }
-        else
-        {
-            // Not enough proper samples found -> error in data.
-            self->rx_bit.sync_index = 0;
-            self->rx_bit.low_sample_count = 0;
-            self->rx_bit.high_sample_count = 0;
-            // No bit
-            return -1;
-        }
+        return rx_decide_bit(self);
     }
     // Continue sampling
     self->rx_bit.sync_index += 1;
     return 0;    
 }
 
-void rx_signal_callback(RX_Device* self, uint8_t signal_status)
+// Adds the margin of the latest bit to the quality of the frame being read, and keeps the weakest bits
+static inline void rx_note_bit(RX_Device* self)
+{
+    if (self->state < RX_READ_LENGTH)
+    {
+        return;
+    }
+    uint8_t const margin = self->rx_bit.confidence;
+    uint16_t const index = self->frame_bit_count++;
+    self->margin_sum += margin;
+    if (margin < self->weakest_margin)
+    {
+        self->weakest_margin = margin;
+    }
+    if (!self->crc_repair || self->state == RX_READ_LENGTH || self->line_coding != RF_LINE_CODING_NRZ ||
+        margin >= self->config.sampling_count - 2)
+    {
+        return;
+    }
+    // Insert by margin, dropping the strongest when full
+    uint8_t i = self->weak_bit_count < RX_REPAIR_BITS ? self->weak_bit_count++ : RX_REPAIR_BITS;
+    while (i > 0 && self->weak_bits[i - 1].margin > margin)
+    {
+        if (i < RX_REPAIR_BITS)
+        {
+            self->weak_bits[i] = self->weak_bits[i - 1];
+        }
+        i -= 1;
+    }
+    if (i < RX_REPAIR_BITS)
+    {
+        self->weak_bits[i].index = index;
+        self->weak_bits[i].margin = margin;
+    }
+}
+
+static void rx_process_signal(RX_Device* self, uint8_t signal_status)
 {
+    rx_advance_sample_clock(self);
+    self->stats.state_samples[self->state] += 1;
+    uint8_t const previous_state = self->signal_state;
     self->signal_state = signal_status;
  
     if (self->state != RX_SYNC) // Sampling not done for SYNC state
     {
-        int res = rx_do_sampling(self);
+        int res = rx_do_sampling(self, previous_state);
         if (!res)
         {
             // Continue
@@ -151,26 +451,276 @@ void rx_signal_callback(RX_Device* self, uint8_t signal_status)
         else if (res < 0)
         {
             // Error in data, go back to sync state
-            rx_return_to_sync(self);
+            rx_return_to_sync(self, RX_LOSS_SAMPLE);
             return;
         } 
+        rx_note_bit(self);
+    }
+    if (self->state_function)
+    {
+        self->state_function(self);
+    }
+}
+
+void rx_signal_callback(RX_Device* self, uint8_t signal_status)
+{
+    uint32_t const start = rx_isr_begin(self);
+    if (self->capture)
+    {
+        rf_capture_sample(self->capture, signal_status);
+    }
+    rx_process_signal(self, signal_status);
+    rx_isr_end(self, start);
+}
+
+void rx_set_synchronized(RX_Device* self)
+{
+    rx_set_state(self, RX_WAIT_START);
+}
+
+void rx_bit_callback(RX_Device* self, int8_t bit)
+{
+    self->stats.state_samples[self->state] += self->config.sampling_count;
+    self->rx_bit.confidence = self->config.sampling_count - 2;
+    if (bit < 0 && rx_guesses_bits(self))
+    {
+        // Leave the bit to the Hamming decoder or the CRC repair
+        bit = 0;
+        self->rx_bit.confidence = 0;
     }
+    if (bit < 0)
+    {
+        // Error in data, go back to sync state
+        rx_return_to_sync(self, RX_LOSS_SAMPLE);
+        return;
+    }
+    self->rx_bit.latest_bit = bit;
+    rx_note_bit(self);
     if (self->state_function)
     {
         self->state_function(self);
     }
 }
 
+// Returns count (<= 32) samples starting at sample index pos
+static inline uint32_t rx_packed_window(const uint32_t* packed, size_t pos, uint8_t count)
+{
+    size_t const word = pos >> 5;
+    uint8_t const shift = pos & 31;
+    uint64_t window = packed[word];
+    if (shift + count > 32)
+    {
+        window |= (uint64_t) packed[word + 1] << 32;
+    }
+    return (uint32_t) (window >> shift) & (uint32_t) ((1ULL << count) - 1);
+}
+
+void rx_feed_samples(RX_Device* self, const uint32_t* packed, size_t nbits)
+{
+    uint32_t const start = rx_isr_begin(self);
+    uint8_t const sampling_count = self->config.sampling_count;
+    size_t pos = 0;
+    if (self->capture)
+    {
+        rf_capture_packed(self->capture, packed, nbits);
+    }
+    while (pos < nbits)
+    {
+        if (self->state == RX_SYNC)
+        {
+            // Sync pattern matching works sample by sample
+            self->signal_state = (packed[pos >> 5] >> (pos & 31)) & 1;
+            pos += 1;
+            self->stats.state_samples[RX_SYNC] += 1;
+            if (self->state_function)
+            {
+                self->state_function(self);
+            }
+            continue;
+        }
+
+        // Take the rest of the current bit, or what is left of the block
+        uint8_t const slot = self->rx_bit.sync_index;
+        size_t take = sampling_count - slot;
+        if (take > nbits - pos)
+        {
+            take = nbits - pos;
+        }
+
+        // Count the slots between the first and last one, as rx_do_sampling does
+        uint8_t const first = slot ? slot : 1;
+        uint8_t last = slot + take - 1;
+        if (last > sampling_count - 2)
+        {
+            last = sampling_count - 2;
+        }
+        if (last >= first)
+        {
+            uint8_t const count = last - first + 1;
+            uint8_t const high = __builtin_popcount(rx_packed_window(packed, pos + first - slot, count));
+            self->rx_bit.high_sample_count += high;
+            self->rx_bit.low_sample_count += count - high;
+        }
+        self->signal_state = (packed[(pos + take - 1) >> 5] >> ((pos + take - 1) & 31)) & 1;
+        pos += take;
+        self->stats.state_samples[self->state] += take;
+
+        if (slot + take < sampling_count)
+        {
+            // Bit continues in the next block
+            self->rx_bit.sync_index = slot + take;
+            continue;
+        }
+        if (rx_decide_bit(self) < 0)
+        {
+            // Error in data, go back to sync state
+            rx_return_to_sync(self, RX_LOSS_SAMPLE);
+            continue;
+        }
+        rx_note_bit(self);
+        if (self->state_function)
+        {
+            self->state_function(self);
+        }
+    }
+    rx_isr_end(self, start);
+}
+
+// Feeds a run of bits with the same level to the state machine
+static void rx_edge_feed_bits(RX_Device* self, uint8_t level, uint32_t bit_count)
+{
+    uint32_t sync_bit_count = 0;
+    while (bit_count--)
+    {
+        self->stats.state_samples[self->state] += self->config.sampling_count;
+        if (self->state == RX_SYNC)
+        {
+            if (!self->state_function || ++sync_bit_count > RX_SYNC_PATTERN_BITS)
+            {
+                // Waiting for external sync, or the sync buffer holds only this level already
+                return;
+            }
+            // Replay the bit as samples so the static sync pattern matches as with the sampler
+            self->signal_state = level;
+            for (uint8_t i = 0; i < self->config.sampling_count && self->state == RX_SYNC; i++)
+            {
+                self->state_function(self);
+            }
+        }
+        else
+        {
+            self->rx_bit.latest_bit = level;
+            // The bit where a glitch was absorbed is a guess
+            self->rx_bit.confidence = self->edge_glitch ? 0 : self->config.sampling_count - 2;
+            self->edge_glitch = 0;
+            rx_note_bit(self);
+            self->state_function(self);
+        }
+    }
+}
+
+void rx_edge_callback(RX_Device* self, uint32_t timestamp_us, uint8_t level)
+{
+    uint32_t const start = rx_isr_begin(self);
+    uint8_t const run_level = self->signal_state;
+    if (self->capture)
+    {
+        rf_capture_edge(self->capture, timestamp_us, level);
+    }
+
+    if (!self->edge_seen)
+    {
+        // Nothing to measure before the first edge
+        self->edge_seen = 1;
+    }
+    else
+    {
+        uint32_t const run = timestamp_us - self->last_edge_timestamp;
+        uint32_t const bit_count = (run + self->sync_rate / 2) / self->sync_rate;
+
+        if (!bit_count && rx_guesses_bits(self))
+        {
+            // Shorter than half a bit, take it for a glitch: the run is counted in the next one
+            self->edge_glitch = 1;
+            self->signal_state = level ? 1 : 0;
+            rx_isr_end(self, start);
+            return;
+        }
+        else if (!bit_count)
+        {
+            // Shorter than half a bit, error in data
+            rx_return_to_sync(self, RX_LOSS_SAMPLE);
+        }
+        else
+        {
+            rx_edge_feed_bits(self, run_level, bit_count);
+        }
+    }
+    self->last_edge_timestamp = timestamp_us;
+    self->signal_state = level ? 1 : 0;
+    rx_isr_end(self, start);
+}
+
+static uint8_t rx_process_flush(RX_Device* self, uint32_t timestamp_us)
+{
+    if (!self->edge_seen)
+    {
+        return 0;
+    }
+    // Only complete bits, the rest of the run is rounded when the next edge arrives
+    uint8_t const run_level = self->signal_state;
+    uint32_t const bit_count = (timestamp_us - self->last_edge_timestamp) / self->sync_rate;
+    self->last_edge_timestamp += bit_count * self->sync_rate;
+    rx_edge_feed_bits(self, run_level, bit_count);
+    self->signal_state = run_level;
+
+    // A frame may still be waiting for bits of this run
+    return self->state != RX_SYNC;
+}
+
+uint8_t rx_edge_flush(RX_Device* self, uint32_t timestamp_us)
+{
+    uint32_t const start = rx_isr_begin(self);
+    if (self->capture)
+    {
+        rf_capture_edge_flush(self->capture, timestamp_us);
+    }
+    uint8_t const in_frame = rx_process_flush(self, timestamp_us);
+    rx_isr_end(self, start);
+    return in_frame;
+}
+
 static void rx_state_process_sync(RX_Device* self)
 {
         // Using static synchronization
 
         self->buffer |= self->signal_state;
         self->buffer &= self->sync_pattern_mask;
-        if (self->buffer == self->sync_pattern)
+        uint8_t const distance = __builtin_popcountll(self->buffer ^ self->sync_pattern);
+        uint8_t const candidate = self->sync_best_distance != RX_SYNC_NO_CANDIDATE;
+
+        if (distance <= self->config.sync_tolerance && distance < self->sync_best_distance)
+        {
+            // Best aligned window so far
+            self->sync_best_distance = distance;
+            self->sync_best_age = 0;
+        }
+        else if (candidate)
+        {
+            self->sync_best_age += 1;
+        }
+
+        if (self->sync_best_distance == 0 ||
+            (candidate && (distance > self->sync_best_distance || 
+                           self->sync_best_age >= self->config.sampling_count / 2)))
         {
-            // Sync pattern found and our sampler is in sync. Start reading bits.
+            // Sync pattern found. The samples after the best window belong to the next bit.
+            uint8_t const age = self->sync_best_age;
+            uint8_t const high = age > 1 ? __builtin_popcountll(self->buffer & ((1ULL << (age - 1)) - 1)) : 0;
             rx_set_state(self, RX_WAIT_START);
+            self->rx_bit.sync_index = age;
+            self->rx_bit.high_sample_count = high;
+            self->rx_bit.low_sample_count = age > 1 ? age - 1 - high : 0;
         }
         else
         {
@@ -179,6 +729,22 @@ static void rx_state_process_sync(RX_Device* self)
         }
 }
 
+// After a frame, returns 1 while the bits so far may still be the frame_gap low bits and the start
+// symbol of the next frame of a train. The wake-up pulse or sync of a new preamble never are.
+static inline uint8_t rx_train_continues(RX_Device* self)
+{
+    uint8_t const length = self->config.frame_gap + START_SYMBOL_LENGTH;
+    uint8_t const count = self->buffer_current_bit_index + 1;
+    if (count > length)
+    {
+        return 0;
+    }
+    uint8_t const shift = length - count;
+    uint64_t const start = shift < START_SYMBOL_LENGTH ? (START_SYMBOL >> shift) : 0;
+    uint64_t const start_bytes = shift < START_SYMBOL_LENGTH ? (START_SYMBOL_BYTES >> shift) : 0;
+    return self->buffer == start || (self->byte_buffer && self->buffer == start_bytes);
+}
+
 static void rx_state_process_wait_start(RX_Device* self)
 {
     self->buffer |= self->rx_bit.latest_bit;
@@ -186,12 +752,24 @@ static void rx_state_process_wait_start(RX_Device* self)
     if (self->buffer == START_SYMBOL) 
     {
         // Start symbol found, start reading length
+        self->byte_frame = 0;
         rx_set_state(self, RX_READ_LENGTH);
     }  
-    else if (self->buffer_current_bit_index > (SYNC_SYMBOL_LENGTH + START_SYMBOL_LENGTH)) 
+    else if (self->byte_buffer && self->buffer == START_SYMBOL_BYTES)
+    {
+        // Start of a byte frame
+        self->byte_frame = 1;
+        rx_set_state(self, RX_READ_LENGTH);
+    }
+    else if (self->frame_done && !rx_train_continues(self))
+    {
+        // No train follows, resync on the preamble right away
+        rx_return_to_sync(self, RX_LOSS_END_OF_TRAIN);
+    }
+    else if (self->buffer_current_bit_index > self->start_timeout) 
     {
         // No start symbol found. Go back to sync state
-        rx_return_to_sync(self);
+        rx_return_to_sync(self, self->frame_done ? RX_LOSS_END_OF_TRAIN : RX_LOSS_NO_START);
     }
     else
     {
@@ -204,18 +782,39 @@ static void rx_state_process_wait_start(RX_Device* self)
 static void rx_state_process_read_length(RX_Device* self)
 {  
     self->buffer |= self->rx_bit.latest_bit;
-    if (self->buffer_current_bit_index == (PAYLOAD_LENGTH - 1))
+    rf_crc16_add_bit(&(self->crc), self->rx_bit.latest_bit);
+    if (self->byte_frame && self->buffer_current_bit_index == (PAYLOAD_BYTE_LENGTH - 1))
     {
-        if (self->buffer <= MAX_PAYLOAD_LENGTH)
+        if (self->buffer && self->buffer <= self->byte_buffer_size)
+        {
+            // Length in bytes found, start reading bytes
+            self->byte_length = self->buffer;
+            rx_set_state(self, RX_READ_BYTES);
+        }
+        else
+        {
+            // Invalid length. Go back to sync state
+            rx_return_to_sync(self, RX_LOSS_LENGTH);
+        }
+    }
+    else if (!self->byte_frame && self->buffer_current_bit_index == (PAYLOAD_LENGTH - 1))
+    {
+        if (self->buffer < self->filter_length)
+        {
+            // Too short for the filtered bits. Go back to sync state
+            rx_return_to_sync(self, RX_LOSS_FILTERED);
+        }
+        else if (self->buffer <= MAX_PAYLOAD_LENGTH)
         {
             // Length found, start reading payload
             self->message.message_length = self->buffer;
+            self->filter_bit_index = self->buffer - 1 - self->filter_shift;
             rx_set_state(self, RX_READ_PAYLOAD);
         }
         else
         {
             // Invalid length. Go back to sync state
-            rx_return_to_sync(self);
+            rx_return_to_sync(self, RX_LOSS_LENGTH);
         }
     }
     else
@@ -229,7 +828,14 @@ static void rx_state_process_read_length(RX_Device* self)
 static void rx_state_process_read_payload(RX_Device* self)
 {
     self->buffer |= self->rx_bit.latest_bit;
-    if (self->buffer_current_bit_index == (self->message.message_length - 1))
+    rf_crc16_add_bit(&(self->crc), self->rx_bit.latest_bit);
+    if (self->filter_mask && self->buffer_current_bit_index == self->filter_bit_index &&
+        ((self->buffer << self->filter_shift) ^ self->filter_value) & self->filter_mask)
+    {
+        // The filtered bits are in, not for us. Go back to sync state
+        rx_return_to_sync(self, RX_LOSS_FILTERED);
+    }
+    else if (self->buffer_current_bit_index == (self->message.message_length - 1))
     {
         // Payload received
         self->message.message = self->buffer;
@@ -243,6 +849,249 @@ static void rx_state_process_read_payload(RX_Device* self)
     }
 }
 
+static void rx_state_process_read_bytes(RX_Device* self)
+{
+    self->buffer |= self->rx_bit.latest_bit;
+    if (self->buffer_current_bit_index == 7)
+    {
+        // Byte received, store it directly to the caller's buffer
+        self->byte_buffer[self->byte_index] = self->buffer;
+        rf_crc16_add_byte(&(self->crc), self->buffer);
+        self->byte_index += 1;
+        self->buffer = 0;
+        self->buffer_current_bit_index = 0;
+        if (self->byte_index == self->byte_length)
+        {
+            rx_set_state(self, RX_READ_CRC);
+        }
+    }
+    else
+    {
+        // Continue
+        self->buffer <<= 1ULL;
+        self->buffer_current_bit_index += 1;
+    }
+}
+
+// Passes a decoded nibble bit by bit to the field state function
+static void rx_deliver_nibble(RX_Device* self, uint8_t nibble)
+{
+    RX_State const state = self->state;
+    for (int8_t i = 3; i >= 0; i--)
+    {
+        if (self->pad_bit_count)
+        {
+            // Padding of the field to whole nibbles
+            self->pad_bit_count -= 1;
+            continue;
+        }
+        self->rx_bit.latest_bit = (nibble >> i) & 1;
+        self->field_function(self);
+        if (self->state != state)
+        {
+            // Field done, fields end on a nibble boundary
+            return;
+        }
+    }
+}
+
+// Collects a 4b6b symbol and passes its nibble bit by bit to the field state function
+static void rx_state_decode_4b6b(RX_Device* self)
+{
+    self->symbol = (self->symbol << 1) | self->rx_bit.latest_bit;
+    self->symbol_bit_count += 1;
+    if (self->symbol_bit_count < 6)
+    {
+        // Continue
+        return;
+    }
+
+    uint8_t const nibble = rx_4b6b_nibbles[self->symbol & 0x3F];
+    self->symbol = 0;
+    self->symbol_bit_count = 0;
+    if (nibble == 0xFF)
+    {
+        // Not a valid symbol, error in data
+        rx_return_to_sync(self, RX_LOSS_SYMBOL);
+        return;
+    }
+    rx_deliver_nibble(self, nibble);
+}
+
+// Collects a Hamming(7,4) codeword and passes the nibble of the closest codeword to the field state function
+static void rx_state_decode_hamming74(RX_Device* self)
+{
+    self->symbol_confidence[self->symbol_bit_count] = self->rx_bit.confidence;
+    self->symbol = (self->symbol << 1) | self->rx_bit.latest_bit;
+    self->symbol_bit_count += 1;
+    if (self->symbol_bit_count < 7)
+    {
+        // Continue
+        return;
+    }
+
+    // Soft decision: the codeword whose differing bits have the least confidence in total
+    uint8_t nibble = 0;
+    uint16_t best_cost = UINT16_MAX;
+    for (uint8_t i = 0; i < 16 && best_cost; i++)
+    {
+        uint8_t const difference = rx_hamming74_codewords[i] ^ self->symbol;
+        uint16_t cost = 0;
+        for (uint8_t j = 0; j < 7 && cost < best_cost; j++)
+        {
+            if ((difference >> (6 - j)) & 1)
+            {
+                cost += self->symbol_confidence[j];
+            }
+        }
+        if (cost < best_cost)
+        {
+            best_cost = cost;
+            nibble = i;
+        }
+    }
+    self->stats.corrected_bits += __builtin_popcount(rx_hamming74_codewords[nibble] ^ self->symbol);
+    self->symbol = 0;
+    self->symbol_bit_count = 0;
+    rx_deliver_nibble(self, nibble);
+}
+
+// Flips one bit of the received payload or CRC, by its line bit index in the frame
+static void rx_flip_frame_bit(RX_Device* self, uint16_t index)
+{
+    uint16_t const payload_bits = self->byte_frame ? self->byte_length * 8 : self->message.message_length;
+    uint16_t const position = index - (self->byte_frame ? PAYLOAD_BYTE_LENGTH : PAYLOAD_LENGTH);
+    if (position >= payload_bits)
+    {
+        self->message.message_crc ^= 0x8000 >> (position - payload_bits);
+    }
+    else if (self->byte_frame)
+    {
+        self->byte_buffer[position >> 3] ^= 0x80 >> (position & 7);
+    }
+    else
+    {
+        self->message.message ^= 1ULL << (payload_bits - 1 - position);
+    }
+}
+
+// Chase decoding: flips the combinations of the weakest bits until the CRC matches
+static uint8_t rx_repair_frame(RX_Device* self)
+{
+    for (uint8_t pattern = 1; pattern < (1 << self->weak_bit_count); pattern++)
+    {
+        for (uint8_t i = 0; i < self->weak_bit_count; i++)
+        {
+            if ((pattern >> i) & 1)
+            {
+                rx_flip_frame_bit(self, self->weak_bits[i].index);
+            }
+        }
+        uint16_t const crc = self->byte_frame ? rf_crc16_bytes(self->byte_buffer, self->byte_length) :
+                                                rf_crc16_message(&(self->message));
+        if (crc == self->message.message_crc)
+        {
+            self->message.quality.repaired_bits = __builtin_popcount(pattern);
+            return 1;
+        }
+        // Undo
+        for (uint8_t i = 0; i < self->weak_bit_count; i++)
+        {
+            if ((pattern >> i) & 1)
+            {
+                rx_flip_frame_bit(self, self->weak_bits[i].index);
+            }
+        }
+    }
+    return 0;
+}
+
+// Key of the frame just received for the dedup filter, never 0
+static uint32_t rx_dedup_key(RX_Device* self)
+{
+    uint64_t value;
+    if (self->byte_frame)
+    {
+        // FNV-1a over the payload
+        value = 0xCBF29CE484222325ULL;
+        for (uint8_t i = 0; i < self->byte_length; i++)
+        {
+            value = (value ^ self->byte_buffer[i]) * 0x100000001B3ULL;
+        }
+        value ^= ((uint64_t) self->message.message_crc << 8) | self->byte_length;
+    }
+    else if (self->dedup_key_mask)
+    {
+        value = self->message.message & self->dedup_key_mask;
+    }
+    else
+    {
+        value = self->message.message ^ ((uint64_t) self->message.message_crc << 48)
+                ^ ((uint64_t) self->message.message_length << 40);
+    }
+    uint32_t const key = (uint32_t) ((value * 0x9E3779B97F4A7C15ULL) >> 32);
+    return key ? key : 1;
+}
+
+// Returns 1 if the frame was delivered within the window, otherwise remembers it and returns 0
+static uint8_t rx_dedup_is_duplicate(RX_Device* self)
+{
+    uint32_t const key = rx_dedup_key(self);
+    uint32_t const now = self->get_dedup_time(self->user_data);
+    RX_Dedup_Entry* free_entry = NULL;
+    RX_Dedup_Entry* oldest_entry = NULL;
+    uint32_t oldest_age = 0;
+
+    // Linear probing from the home slot, entries are never emptied so a free slot ends the search
+    for (uint16_t i = 0; i <= self->dedup_mask; i++)
+    {
+        RX_Dedup_Entry* const entry = &(self->dedup_table[(key + i) & self->dedup_mask]);
+        uint32_t const age = now - entry->time;
+        if (!entry->key)
+        {
+            free_entry = free_entry ? free_entry : entry;
+            break;
+        }
+        if (age < self->dedup_window)
+        {
+            if (entry->key == key)
+            {
+                return 1;
+            }
+            if (age >= oldest_age)
+            {
+                oldest_age = age;
+                oldest_entry = entry;
+            }
+        }
+        else if (!free_entry)
+        {
+            // Expired, reusable
+            free_entry = entry;
+        }
+    }
+    RX_Dedup_Entry* const entry = free_entry ? free_entry : oldest_entry;
+    entry->key = key;
+    entry->time = now;
+    return 0;
+}
+
+static void rx_deliver_frame(RX_Device* self)
+{
+    if (self->byte_frame)
+    {
+        self->bytes_callback(self->byte_buffer, self->byte_length, self->message.message_crc);
+    }
+    else if (self->message_queue)
+    {
+        rx_queue_message(self);
+    }
+    else
+    {
+        self->result_callback(&self->message);
+    }
+}
+
 static void rx_state_process_read_crc(RX_Device* self)
 {
     self->buffer |= self->rx_bit.latest_bit;
@@ -250,8 +1099,36 @@ static void rx_state_process_read_crc(RX_Device* self)
     {
         // CRC received
         self->message.message_crc = self->buffer;
-        self->result_callback(&self->message);
-        rx_return_to_sync(self);
+        self->message.quality.score = self->frame_bit_count ? 
+            (uint8_t) ((self->margin_sum * 255) / (self->frame_bit_count * (self->config.sampling_count - 2))) : 0;
+        self->message.quality.weakest_margin = self->weakest_margin;
+        self->message.quality.repaired_bits = 0;
+        if (self->message.message_crc != rf_crc16_value(&(self->crc)))
+        {
+            if (!self->weak_bit_count || !rx_repair_frame(self))
+            {
+                // Corrupted frame, drop it and go back to sync state
+                rx_return_to_sync(self, RX_LOSS_CRC);
+                return;
+            }
+            self->stats.repaired_frames += 1;
+        }
+        self->frame_done = 1;
+        if (self->dedup_table && rx_dedup_is_duplicate(self))
+        {
+            // A repeated copy, dropped
+            self->stats.duplicate_frames += 1;
+            TRACE(RF_TRACE_RX_DUPLICATE, self->message.message_crc);
+        }
+        else
+        {
+            self->stats.frames_received += 1;
+            TRACE(RF_TRACE_RX_FRAME, self->message.message_crc);
+            rx_deliver_frame(self);
+        }
+        // Stay in sync, a back-to-back frame may follow with just a start symbol
+        rx_set_state(self, RX_WAIT_START);
+        self->start_timeout = self->config.frame_gap + START_SYMBOL_LENGTH;
     }
     else
     {
@@ -266,24 +1143,41 @@ void rx_start_receiving(RX_Device* self)
     rx_set_state(self, RX_SYNC);
     if (!self->ext_synchronizer)
     {
-        self->set_recurring_trigger_time((TX_FREQUENCY / SAMPLING_COUNT), self->user_data);
+        uint32_t sample_period = ((uint32_t) self->config.bit_time << RX_PERIOD_FRACTION_BITS) / 
+                                 self->config.sampling_count;
+        if (!self->set_trigger_period)
+        {
+            // Whole us only
+            sample_period &= ~((1UL << RX_PERIOD_FRACTION_BITS) - 1);
+        }
+        rx_start_sample_clock(self, sample_period);
     }
 }
 
+void rx_start_edge_receiving(RX_Device* self)
+{
+    self->edge_seen = 0;
+    rx_set_state(self, RX_SYNC);
+}
+
 void rx_stop_receiving(RX_Device* self)
 {
     self->cancel_trigger(self->user_data);
-    free(self->ext_synchronizer);
-    self->ext_synchronizer = NULL;
 }
 
 static void rx_set_state(RX_Device* self, RX_State state)
 {
-    TRACE("Setting state to %d", state);
+    TRACE(RF_TRACE_RX_STATE, state);
+    if (self->state == RX_SYNC && state == RX_WAIT_START)
+    {
+        self->stats.sync_count += 1;
+    }
     self->state = state;
     switch (state)
     {
         case RX_SYNC:
+            self->frame_done = 0;
+            self->edge_glitch = 0;
             if (self->ext_synchronizer)
             {
                 self->ext_synchronizer->wait_for_sync(self->ext_synchronizer, self);
@@ -292,17 +1186,28 @@ static void rx_set_state(RX_Device* self, RX_State state)
             else
             {
                 self->state_function = rx_state_process_sync;
+                self->sync_best_distance = RX_SYNC_NO_CANDIDATE;
             }
             break;
         case RX_WAIT_START:                    
             self->state_function = rx_state_process_wait_start;
+            self->start_timeout = self->config.sync_symbol_length + START_SYMBOL_LENGTH;
             break;
         case RX_READ_LENGTH:
             self->state_function = rx_state_process_read_length;
+            rf_crc16_init(&(self->crc));
+            self->margin_sum = 0;
+            self->frame_bit_count = 0;
+            self->weakest_margin = UINT8_MAX;
+            self->weak_bit_count = 0;
             break;
         case RX_READ_PAYLOAD:
             self->state_function = rx_state_process_read_payload;
             break;
+        case RX_READ_BYTES:
+            self->state_function = rx_state_process_read_bytes;
+            self->byte_index = 0;
+            break;
         case RX_READ_CRC:
             self->state_function = rx_state_process_read_crc;
             break;    
@@ -310,6 +1215,26 @@ static void rx_set_state(RX_Device* self, RX_State state)
             break;
     }
 
+    if (self->line_coding != RF_LINE_CODING_NRZ && state >= RX_READ_LENGTH)
+    {
+        // Decode the symbols before the field state function
+        uint8_t field_bits = 0;
+        if (state == RX_READ_LENGTH)
+        {
+            field_bits = self->byte_frame ? PAYLOAD_BYTE_LENGTH : PAYLOAD_LENGTH;
+        }
+        else if (state == RX_READ_PAYLOAD)
+        {
+            field_bits = self->message.message_length;
+        }
+        self->pad_bit_count = (4 - (field_bits & 3)) & 3;
+        self->symbol = 0;
+        self->symbol_bit_count = 0;
+        self->field_function = self->state_function;
+        self->state_function = self->line_coding == RF_LINE_CODING_4B6B ? rx_state_decode_4b6b :
+                                                                         rx_state_decode_hamming74;
+    }
+
     self->buffer = 0;
     self->buffer_current_bit_index = 0;
 }
@@ -0,0 +1,200 @@
+#include <string.h>
+#include "rx_edge_synchronizer.h"
+#include "debug_logging.h"
+
+static void rx_edge_sync_restart(RX_Edge_Synchronizer* self, uint32_t timestamp_us)
+{
+    self->first_timestamp = timestamp_us;
+    self->last_timestamp = timestamp_us;
+    self->offset[0] = 0;
+    self->bit_index[0] = 0;
+    self->edge_count = 1;
+    self->bit_time = 0;
+}
+
+static void rx_edge_sync_wait_for_sync(RX_Synchronizer* base, RX_Device* rx_device)
+{
+    RX_Edge_Synchronizer* const self = (RX_Edge_Synchronizer*) base;
+    uint8_t needed_edges = rx_device->config.sync_symbol_length / 2;
+
+    if (needed_edges > RX_EDGE_SYNC_MAX_EDGES)
+    {
+        needed_edges = RX_EDGE_SYNC_MAX_EDGES;
+    }
+    else if (needed_edges < RX_EDGE_SYNC_MIN_EDGES)
+    {
+        needed_edges = RX_EDGE_SYNC_MIN_EDGES;
+    }
+    uint32_t const bit_time = rx_device->config.bit_time;
+    self->min_bit_time = bit_time - (bit_time * RX_EDGE_SYNC_RATE_RANGE) / 100;
+    self->max_bit_time = bit_time + (bit_time * RX_EDGE_SYNC_RATE_RANGE) / 100;
+    self->rx_device = rx_device;
+    self->needed_edges = needed_edges;
+    self->edge_count = 0;
+    self->active = 1;
+    if (self->enable_edges)
+    {
+        self->enable_edges(1, self->user_data);
+    }
+}
+
+// Fits offset = phase + k * period over the edges marked in used. Returns the period in
+// RX_EDGE_SYNC_FRACTION_BITS fixed point, phase in the same format through phase_out.
+static int64_t rx_edge_sync_fit(RX_Edge_Synchronizer* self, const uint8_t* used, int64_t* phase_out)
+{
+    int64_t n = 0, sum_k = 0, sum_kk = 0, sum_d = 0, sum_kd = 0;
+
+    for (uint8_t i = 0; i < self->edge_count; i++)
+    {
+        if (used[i])
+        {
+            int64_t const k = self->bit_index[i];
+            int64_t const d = self->offset[i];
+            n += 1;
+            sum_k += k;
+            sum_kk += k * k;
+            sum_d += d;
+            sum_kd += k * d;
+        }
+    }
+    int64_t const denominator = n * sum_kk - sum_k * sum_k;
+    if (n < 2 || !denominator)
+    {
+        return 0;
+    }
+    int64_t const period = ((n * sum_kd - sum_k * sum_d) << RX_EDGE_SYNC_FRACTION_BITS) / denominator;
+    *phase_out = ((sum_d << RX_EDGE_SYNC_FRACTION_BITS) - period * sum_k) / n;
+    return period;
+}
+
+// Fits the collected edges and drops the ones off by more than 1/8 bit. Returns the period in
+// RX_EDGE_SYNC_FRACTION_BITS fixed point, or 0 if the edges do not make a sync symbol.
+static uint32_t rx_edge_sync_solve(RX_Edge_Synchronizer* self)
+{
+    uint8_t used[RX_EDGE_SYNC_MAX_EDGES];
+    int64_t phase = 0;
+    memset(used, 1, sizeof(used));
+
+    int64_t period = rx_edge_sync_fit(self, used, &phase);
+    if (period <= 0)
+    {
+        return 0;
+    }
+    int64_t const limit = period / 8;
+    uint8_t outlier_count = 0;
+    for (uint8_t i = 0; i < self->edge_count; i++)
+    {
+        int64_t residual = ((int64_t) self->offset[i] << RX_EDGE_SYNC_FRACTION_BITS) -
+                           (phase + period * self->bit_index[i]);
+        if (residual < 0)
+        {
+            residual = -residual;
+        }
+        if (residual > limit)
+        {
+            used[i] = 0;
+            outlier_count += 1;
+        }
+    }
+    if (outlier_count * 4 > self->edge_count)
+    {
+        TRACE(RF_TRACE_SYNC_OUTLIERS, outlier_count);
+        return 0;
+    }
+    if (outlier_count)
+    {
+        period = rx_edge_sync_fit(self, used, &phase);
+    }
+    if (period < ((int64_t) self->min_bit_time << RX_EDGE_SYNC_FRACTION_BITS) ||
+        period > ((int64_t) self->max_bit_time << RX_EDGE_SYNC_FRACTION_BITS))
+    {
+        return 0;
+    }
+    return (uint32_t) period;
+}
+
+void rx_edge_sync_init(RX_Edge_Synchronizer* self, void* enable_edges, void* user_data)
+{
+    memset(self, 0, sizeof(RX_Edge_Synchronizer));
+    self->base.wait_for_sync = rx_edge_sync_wait_for_sync;
+    self->enable_edges = enable_edges;
+    self->user_data = user_data;
+}
+
+void rx_edge_sync_callback(RX_Edge_Synchronizer* self, uint32_t timestamp_us, uint8_t level)
+{
+    if (!self->active)
+    {
+        return;
+    }
+    if (!self->edge_count)
+    {
+        rx_edge_sync_restart(self, timestamp_us);
+        return;
+    }
+    uint32_t const interval = timestamp_us - self->last_timestamp;
+
+    if (!self->bit_time)
+    {
+        // The first interval sets the estimate, it must be a possible bit time
+        if (interval < self->min_bit_time || interval > self->max_bit_time)
+        {
+            rx_edge_sync_restart(self, timestamp_us);
+            return;
+        }
+        self->bit_time = interval;
+        self->offset[1] = interval;
+        self->bit_index[1] = 1;
+        self->edge_count = 2;
+        self->last_timestamp = timestamp_us;
+    }
+    else if (interval < self->bit_time / 2)
+    {
+        // Glitch, ignore the edge
+        return;
+    }
+    else
+    {
+        // Sync bits alternate, so edges are one bit apart. Allow one edge lost to a glitch.
+        uint32_t const bits = (interval + self->bit_time / 2) / self->bit_time;
+        int32_t const error = (int32_t) (interval - bits * self->bit_time);
+        if (bits > 2 || error > (int32_t) (self->bit_time / 4) || error < -(int32_t) (self->bit_time / 4))
+        {
+            rx_edge_sync_restart(self, timestamp_us);
+            return;
+        }
+        uint8_t const index = self->edge_count;
+        self->offset[index] = timestamp_us - self->first_timestamp;
+        self->bit_index[index] = self->bit_index[index - 1] + bits;
+        self->edge_count += 1;
+        self->last_timestamp = timestamp_us;
+        self->bit_time = self->offset[index] / self->bit_index[index];
+    }
+
+    if (self->edge_count < self->needed_edges)
+    {
+        // Continue
+        return;
+    }
+    uint32_t const period = rx_edge_sync_solve(self);
+    if (!period)
+    {
+        rx_edge_sync_restart(self, timestamp_us);
+        return;
+    }
+    // This edge starts a bit, hand over to the receiver right away
+    self->fitted_bit_time = period;
+    TRACE(RF_TRACE_SYNC_RATE, period >> RX_EDGE_SYNC_FRACTION_BITS);
+    rx_edge_sync_stop(self);
+    rx_set_detected_bit_period(self->rx_device, period << (RX_PERIOD_FRACTION_BITS - RX_EDGE_SYNC_FRACTION_BITS),
+                               level);
+}
+
+void rx_edge_sync_stop(RX_Edge_Synchronizer* self)
+{
+    self->active = 0;
+    if (self->enable_edges)
+    {
+        self->enable_edges(0, self->user_data);
+    }
+}
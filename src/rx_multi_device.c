@@ -0,0 +1,200 @@
+/**
+ * @file rx_multi_device.c
+ * @brief This file contains the implementation of the multi-channel RX device functions.
+ *
+ * Sampling and sync detection are bit-sliced: bit c of every word belongs to channel c, and the
+ * per-channel counters of rx_do_sampling are kept as vertical counters. Only the decided bits
+ * are handed to the per-channel RX_Device state machines.
+ */
+
+#include <string.h>
+#include "debug_logging.h"
+#include "rx_multi_device.h"
+
+static inline void rx_multi_increment(uint32_t* counter, uint32_t lanes)
+{
+    for (uint8_t i = 0; i < RX_MULTI_COUNTER_BITS && lanes; i++)
+    {
+        uint32_t const carry = counter[i] & lanes;
+        counter[i] ^= lanes;
+        lanes = carry;
+    }
+}
+
+static inline void rx_multi_clear(uint32_t* counter, uint32_t lanes)
+{
+    for (uint8_t i = 0; i < RX_MULTI_COUNTER_BITS; i++)
+    {
+        counter[i] &= ~lanes;
+    }
+}
+
+// Lanes where the counter equals value
+static inline uint32_t rx_multi_equals(const uint32_t* counter, uint8_t value)
+{
+    uint32_t lanes = 0xFFFFFFFFUL;
+    for (uint8_t i = 0; i < RX_MULTI_COUNTER_BITS; i++)
+    {
+        lanes &= ((value >> i) & 1) ? counter[i] : ~counter[i];
+    }
+    return lanes;
+}
+
+// Lanes where the counter is at least value
+static inline uint32_t rx_multi_at_least(const uint32_t* counter, uint8_t value)
+{
+    uint32_t greater = 0;
+    uint32_t equal = 0xFFFFFFFFUL;
+    for (int8_t i = RX_MULTI_COUNTER_BITS - 1; i >= 0; i--)
+    {
+        if ((value >> i) & 1)
+        {
+            equal &= counter[i];
+        }
+        else
+        {
+            greater |= equal & counter[i];
+            equal &= ~counter[i];
+        }
+    }
+    return greater | equal;
+}
+
+static void rx_multi_reset_lanes(RX_Multi_Device* self)
+{
+    self->locked_mask = 0;
+    memset(self->slot, 0, sizeof(self->slot));
+    memset(self->high_count, 0, sizeof(self->high_count));
+    memset(self->history, 0, sizeof(self->history));
+    self->history_index = 0;
+}
+
+void rx_multi_init(RX_Multi_Device* self, void* set_recurring_trigger_time,
+                    void* cancel_trigger, void* user_data, const RF_Config* config)
+{
+    memset(self, 0, sizeof(RX_Multi_Device));
+
+    // Set functions
+    self->set_recurring_trigger_time = set_recurring_trigger_time;
+    self->cancel_trigger = cancel_trigger;
+    self->user_data = user_data;
+
+    for (uint8_t i = 0; i < RX_MULTI_MAX_CHANNELS; i++)
+    {
+        rx_init(&(self->channels[i]), NULL, NULL, NULL, NULL, config);
+    }
+    // All channels share the timing and the static sync pattern
+    self->config = self->channels[0].config;
+    self->sync_pattern = self->channels[0].sync_pattern;
+    self->history_length = self->config.sampling_count * RX_SYNC_PATTERN_BITS;
+    self->needed_count = self->config.sampling_count - self->config.sampling_tolerance - 2;
+}
+
+void rx_multi_add_channel(RX_Multi_Device* self, uint8_t channel, void* result_callback)
+{
+    rx_init(&(self->channels[channel]), result_callback, NULL, NULL, NULL, &(self->config));
+    self->channel_mask |= 1UL << channel;
+}
+
+// Decides the bit for the lanes at their last slot and feeds the channel state machines
+static void rx_multi_decide_bits(RX_Multi_Device* self, uint32_t lanes)
+{
+    uint32_t const zero = lanes & ~rx_multi_at_least(self->high_count, self->config.sampling_count - 1 - self->needed_count);
+    uint32_t const one = lanes & ~zero & rx_multi_at_least(self->high_count, self->needed_count);
+    uint32_t unlocked = 0;
+
+    rx_multi_clear(self->slot, lanes);
+    rx_multi_clear(self->high_count, lanes);
+
+    while (lanes)
+    {
+        uint8_t const channel = __builtin_ctz(lanes);
+        uint32_t const lane = 1UL << channel;
+        lanes &= lanes - 1;
+
+        RX_Device* const device = &(self->channels[channel]);
+        rx_bit_callback(device, (one & lane) ? 1 : ((zero & lane) ? 0 : -1));
+        if (device->state == RX_SYNC)
+        {
+            unlocked |= lane;
+        }
+    }
+
+    if (unlocked)
+    {
+        // Start sync matching from an empty buffer, as rx_set_state does
+        self->locked_mask &= ~unlocked;
+        for (uint8_t i = 0; i < self->history_length; i++)
+        {
+            self->history[i] &= ~unlocked;
+        }
+    }
+}
+
+// Returns the lanes whose latest samples equal the sync pattern
+static uint32_t rx_multi_match_sync(RX_Multi_Device* self, uint32_t lanes)
+{
+    uint8_t index = self->history_index;
+    for (uint8_t i = 0; i < self->history_length && lanes; i++)
+    {
+        uint32_t const expected = ((self->sync_pattern >> i) & 1) ? 0xFFFFFFFFUL : 0;
+        lanes &= ~(self->history[index] ^ expected);
+        index = index ? index - 1 : self->history_length - 1;
+    }
+    return lanes;
+}
+
+void rx_multi_signal_callback(RX_Multi_Device* self, uint32_t snapshot)
+{
+    uint32_t const locked = self->locked_mask;
+    uint32_t const hunting = self->channel_mask & ~locked;
+
+    self->history_index = (self->history_index + 1) % self->history_length;
+    self->history[self->history_index] = snapshot;
+
+    if (locked)
+    {
+        // Skip the first and last slot, decide the bit at the last one
+        uint32_t const first = locked & rx_multi_equals(self->slot, 0);
+        uint32_t const last = locked & rx_multi_equals(self->slot, self->config.sampling_count - 1);
+
+        rx_multi_increment(self->high_count, locked & ~first & ~last & snapshot);
+        rx_multi_increment(self->slot, locked & ~last);
+        if (last)
+        {
+            rx_multi_decide_bits(self, last);
+        }
+    }
+
+    if (hunting)
+    {
+        uint32_t lanes = rx_multi_match_sync(self, hunting);
+        self->locked_mask |= lanes;
+        while (lanes)
+        {
+            // Sync pattern found and the sampler is in sync. Start reading bits.
+            uint8_t const channel = __builtin_ctz(lanes);
+            lanes &= lanes - 1;
+            rx_set_synchronized(&(self->channels[channel]));
+        }
+    }
+}
+
+void rx_multi_start_receiving(RX_Multi_Device* self)
+{
+    rx_multi_reset_lanes(self);
+    for (uint8_t i = 0; i < RX_MULTI_MAX_CHANNELS; i++)
+    {
+        if (self->channel_mask & (1UL << i))
+        {
+            // Drop any frame in progress, keeping the settings of the channel. It has no trigger of its own.
+            rx_start_edge_receiving(&(self->channels[i]));
+        }
+    }
+    self->set_recurring_trigger_time((self->config.bit_time / self->config.sampling_count), self->user_data);
+}
+
+void rx_multi_stop_receiving(RX_Multi_Device* self)
+{
+    self->cancel_trigger(self->user_data);
+}
@@ -12,34 +12,136 @@
 #include "rf_device.h"
 
 static void tx_set_state(TX_Device* self, TX_State state);
+static uint8_t tx_dequeue_frame(TX_Device* self);
+
+// 4b6b symbols for nibbles 0 - 15, same table as RH_ASK
+static const uint8_t tx_4b6b_symbols[16] = 
+{
+    0x0D, 0x0E, 0x13, 0x15, 0x16, 0x19, 0x1A, 0x1C, 
+    0x23, 0x25, 0x26, 0x29, 0x2A, 0x2C, 0x32, 0x34
+};
+
+// Hamming(7,4) codewords for nibbles 0 - 15: the nibble and 3 parity bits, XORed with 0000100 so
+// that no data gives runs of more than 8 equal bits
+static const uint8_t tx_hamming74_codewords[16] = 
+{
+    0x04, 0x0F, 0x11, 0x1A, 0x22, 0x29, 0x37, 0x3C,
+    0x43, 0x48, 0x56, 0x5D, 0x65, 0x6E, 0x70, 0x7B
+};
+
+static void tx_play_next_run(TX_Device* self);
+
+static inline uint32_t tx_isr_begin(TX_Device* self)
+{
+#ifdef ENABLE_ISR_STATS
+    return self->get_timestamp ? self->get_timestamp(self->user_data) : 0;
+#else
+    return 0;
+#endif
+}
+
+static inline void tx_isr_end(TX_Device* self, uint32_t start)
+{
+#ifdef ENABLE_ISR_STATS
+    if (self->get_timestamp)
+    {
+        rf_isr_stats_add(&(self->stats.isr), self->get_timestamp(self->user_data) - start);
+    }
+#endif
+}
 
 void tx_callback(TX_Device* self)
 {
-    if (self->state_function)
+    uint32_t const start = tx_isr_begin(self);
+    if (self->edge_scheduled)
+    {
+        tx_play_next_run(self);
+    }
+    else if (self->state_function)
     {
         self->state_function(self);
     }
+    tx_isr_end(self, start);
+}
+
+// Sets the line level for the current step. With edge scheduling the level is only recorded.
+static void tx_output(TX_Device* self, uint8_t level)
+{
+    if (self->edge_scheduled)
+    {
+        self->step_level = level;
+    }
+    else
+    {
+        self->set_signal(level, self->user_data);
+    }
+}
+
+// Sets the time to the next step, once or until changed
+static void tx_wait(TX_Device* self, uint32_t time_to_trigger, uint8_t recurring)
+{
+    if (self->edge_scheduled)
+    {
+        self->step_time = time_to_trigger;
+    }
+    else if (recurring)
+    {
+        self->set_recurring_trigger_time(time_to_trigger, self->user_data);
+    }
+    else
+    {
+        self->set_onetime_trigger_time(time_to_trigger, self->user_data);
+    }
 }
 
 static void tx_send_bit(TX_Device* self, uint64_t buffer, uint8_t bit_index)
 {
     uint64_t mask = 1ULL << bit_index;
-    if (buffer & mask)
+    tx_output(self, (buffer & mask) ? 1 : 0);
+}
+
+// Sends the line bit at line_index of a field, coded according to the line coding
+static void tx_send_field_bit(TX_Device* self, uint64_t value, uint8_t line_index)
+{
+    if (self->line_coding == RF_LINE_CODING_4B6B)
+    {
+        uint8_t const symbol = tx_4b6b_symbols[(value >> (4 * (line_index / 6))) & 0xF];
+        tx_send_bit(self, symbol, line_index % 6);
+    }
+    else if (self->line_coding == RF_LINE_CODING_HAMMING74)
     {
-       self->set_signal(1, self->user_data);
+        uint8_t const codeword = tx_hamming74_codewords[(value >> (4 * (line_index / 7))) & 0xF];
+        tx_send_bit(self, codeword, line_index % 7);
     }
     else
     {
-        self->set_signal(0, self->user_data);
+        tx_send_bit(self, value, line_index);
     }
 }
 
+// Number of line bits for a field of bit_count bits
+static uint8_t tx_field_line_bits(TX_Device* self, uint8_t bit_count)
+{
+    if (self->line_coding == RF_LINE_CODING_4B6B)
+    {
+        return ((bit_count + 3) / 4) * 6;
+    }
+    if (self->line_coding == RF_LINE_CODING_HAMMING74)
+    {
+        return ((bit_count + 3) / 4) * 7;
+    }
+    return bit_count;
+}
+
 void tx_init(TX_Device* self, void (*set_signal), void (*set_onetime_trigger_time), 
                 void (*set_recurring_trigger_time), void (*cancel_trigger), 
-                void (*tx_ready_callback), void* user_data)
+                void (*tx_ready_callback), void* user_data, const RF_Config* config)
 {
-    memset(self, 0, sizeof(TX_Device));
+    static const RF_Config default_config = RF_CONFIG_DEFAULT;
 
+    memset(self, 0, sizeof(TX_Device));
+    self->config = config ? *config : default_config;
+    rf_config_clamp(&(self->config));
 
     // Set functions
     self->set_signal = set_signal;
@@ -48,38 +150,217 @@ void tx_init(TX_Device* self, void (*set_signal), void (*set_onetime_trigger_tim
     self->cancel_trigger = cancel_trigger;
     self->tx_ready = tx_ready_callback;
     self->user_data = user_data;
+#ifdef ENABLE_ISR_STATS
+    rf_isr_stats_reset(&(self->stats.isr));
+#endif
 
     // Start state
     tx_set_state(self, TX_INITIAL);
 }
 
-int8_t tx_send_message(TX_Device* self, RF_Message* message)
+void tx_set_line_coding(TX_Device* self, RF_Line_Coding coding)
+{
+    self->line_coding = coding;
+}
+
+void tx_set_timestamp_hook(TX_Device* self, void* get_timestamp)
+{
+#ifdef ENABLE_ISR_STATS
+    self->get_timestamp = get_timestamp;
+#endif
+}
+
+void tx_reset_stats(TX_Device* self)
+{
+    memset(&(self->stats), 0, sizeof(TX_Stats));
+#ifdef ENABLE_ISR_STATS
+    rf_isr_stats_reset(&(self->stats.isr));
+#endif
+}
+
+void tx_set_edge_scheduling(TX_Device* self, uint8_t enabled)
+{
+    self->edge_scheduled = enabled;
+}
+
+void tx_set_manual_start(TX_Device* self, uint8_t enabled)
+{
+    self->manual_start = enabled;
+}
+
+// Runs one step of the frame state machine. Returns 0 when the frames are done.
+static uint8_t tx_step(TX_Device* self, TX_Run* step)
+{
+    if (self->state == TX_INITIAL)
+    {
+        return 0;
+    }
+    self->state_function(self);
+    step->level = self->step_level;
+    step->duration = self->step_time;
+    return 1;
+}
+
+// Starts the run generator on the frame taken from the queue
+static void tx_start_runs(TX_Device* self)
+{
+    tx_set_state(self, TX_WAKEUP);
+    self->pending_valid = tx_step(self, &(self->pending));
+}
+
+uint8_t tx_next_run(TX_Device* self, TX_Run* run)
+{
+    if (!self->pending_valid)
+    {
+        return 0;
+    }
+    // Merge the steps until the level changes
+    TX_Run step;
+    *run = self->pending;
+    while ((self->pending_valid = tx_step(self, &step)) && step.level == run->level)
+    {
+        run->duration += step.duration;
+    }
+    self->pending = step;
+    return 1;
+}
+
+int16_t tx_compile_runs(TX_Device* self, TX_Run* runs, uint16_t max_runs)
+{
+    if (self->state != TX_INITIAL || self->playing || !tx_dequeue_frame(self))
+    {
+        return 0;
+    }
+    uint8_t const edge_scheduled = self->edge_scheduled;
+    uint16_t count = 0;
+
+    self->edge_scheduled = 1;
+    tx_start_runs(self);
+    while (count < max_runs && tx_next_run(self, &(runs[count])))
+    {
+        count += 1;
+    }
+    self->edge_scheduled = edge_scheduled;
+    if (self->pending_valid)
+    {
+        // Does not fit, drop the rest
+        tx_set_state(self, TX_INITIAL);
+        self->pending_valid = 0;
+        return -1;
+    }
+    return count;
+}
+
+static void tx_play_next_run(TX_Device* self)
+{
+    TX_Run run;
+    if (tx_next_run(self, &run))
+    {
+        self->set_signal(run.level, self->user_data);
+        self->set_onetime_trigger_time(run.duration, self->user_data);
+        return;
+    }
+    self->set_signal(0, self->user_data);
+    if (tx_dequeue_frame(self))
+    {
+        // Queued after the train was generated, start a new one
+        tx_start_runs(self);
+        tx_play_next_run(self);
+        return;
+    }
+    __atomic_store_n(&(self->playing), 0, __ATOMIC_SEQ_CST);
+    self->cancel_trigger(self->user_data);
+    self->tx_ready(self->user_data);
+}
+
+// Takes the next frame from the queue to be sent. Called by the transmitter, or to start it.
+static uint8_t tx_dequeue_frame(TX_Device* self)
 {
-    if (self->state != TX_INITIAL)
+    uint8_t const tail = self->queue_tail;
+    if (__atomic_load_n(&(self->queue_head), __ATOMIC_SEQ_CST) == tail)
     {
+        return 0;
+    }
+    TX_Frame const* frame = &(self->queue[tail & (TX_QUEUE_LENGTH - 1)]);
+    self->message = frame->message;
+    self->payload = frame->payload;
+    self->payload_length = frame->payload_length;
+    self->byte_mode = frame->payload != NULL;
+    __atomic_store_n(&(self->queue_tail), (uint8_t) (tail + 1), __ATOMIC_SEQ_CST);
+    return 1;
+}
+
+static int8_t tx_queue_frame(TX_Device* self, const RF_Message* message, const uint8_t* payload, uint8_t length)
+{
+    uint8_t const head = self->queue_head;
+    if ((uint8_t) (head - __atomic_load_n(&(self->queue_tail), __ATOMIC_SEQ_CST)) >= TX_QUEUE_LENGTH)
+    {
+        self->stats.queue_full_count += 1;
         return -1;
     }
+    TX_Frame* frame = &(self->queue[head & (TX_QUEUE_LENGTH - 1)]);
+    if (message)
+    {
+        frame->message = *message;
+    }
+    frame->payload = payload;
+    frame->payload_length = length;
+    __atomic_store_n(&(self->queue_head), (uint8_t) (head + 1), __ATOMIC_SEQ_CST);
+    self->stats.frames_queued += 1;
+
+    if (!self->manual_start)
+    {
+        tx_start_sending(self);
+    }
+    return 0;
+}
+
+void tx_start_sending(TX_Device* self)
+{
+    // The transmitter checks the queue before it goes idle, so start it only if it is idle already
+    if (__atomic_load_n(&(self->state), __ATOMIC_SEQ_CST) != TX_INITIAL ||
+        __atomic_load_n(&(self->playing), __ATOMIC_SEQ_CST) || !tx_dequeue_frame(self))
+    {
+        return;
+    }
+    if (self->edge_scheduled)
+    {
+        self->playing = 1;
+        tx_start_runs(self);
+    }
     else
     {
-        self->message = *message;
         tx_set_state(self, TX_WAKEUP);
-        tx_callback(self);
-        return 0;
     }
+    tx_callback(self);
+}
+
+int8_t tx_send_message(TX_Device* self, RF_Message* message)
+{
+    return tx_queue_frame(self, message, NULL, 0);
+}
+
+int8_t tx_send_bytes(TX_Device* self, const uint8_t* data, uint8_t length)
+{
+    if (!length || !data)
+    {
+        return -1;
+    }
+    return tx_queue_frame(self, NULL, data, length);
 }
 
 static void tx_state_process_wakeup(TX_Device* self)
 {
     if (self->step_index == 0)
     {
-        self->set_signal(1, self->user_data);
-        self->set_onetime_trigger_time(500, self->user_data);  // sleep 500 us
+        tx_output(self, 1);
+        tx_wait(self, self->config.wakeup_time, 0);
         self->step_index += 1;
     }
     else
     {
-        self->set_signal(0, self->user_data);
-        self->set_onetime_trigger_time(500, self->user_data);  // sleep 500 us
+        tx_output(self, 0);
+        tx_wait(self, self->config.wakeup_time, 0);
         tx_set_state(self, TX_SYNC);
     }
 }
@@ -88,10 +369,10 @@ static void tx_state_process_sync(TX_Device* self)
 {
     self->step_index -= 1;
     tx_send_bit(self, SYNC_SYMBOL, self->step_index);
-    if (self->step_index == (SYNC_SYMBOL_LENGTH - 1))
+    if (self->step_index == (self->config.sync_symbol_length - 1))
     {
         // First bit set, set the recurring trigger time
-        self->set_recurring_trigger_time(TX_FREQUENCY, self->user_data);  // 1ms for each bit
+        tx_wait(self, self->config.bit_time, 1);
     }
     else if (!self->step_index)  // All sent, go to next state
     {
@@ -103,7 +384,7 @@ static void tx_state_process_sync(TX_Device* self)
 static void tx_state_process_send_start(TX_Device* self)
 {
     self->step_index -= 1;
-    tx_send_bit(self, START_SYMBOL, self->step_index);
+    tx_send_bit(self, self->byte_mode ? START_SYMBOL_BYTES : START_SYMBOL, self->step_index);
     if (self->step_index == 0)
     {
         // Done sending start
@@ -114,40 +395,79 @@ static void tx_state_process_send_start(TX_Device* self)
 static void tx_state_process_send_length(TX_Device* self)
 {
     self->step_index -= 1;
-    tx_send_bit(self, self->message.message_length, self->step_index);
+    tx_send_field_bit(self, self->byte_mode ? self->payload_length : self->message.message_length, self->step_index);
     if (self->step_index == 0)
     {
-        // Done sending start
-        tx_set_state(self, TX_SEND_PAYLOAD);
+        // Done sending length
+        tx_set_state(self, self->byte_mode ? TX_SEND_BYTES : TX_SEND_PAYLOAD);
     }
 }
 
 static void tx_state_process_send_payload(TX_Device* self)
 {
     self->step_index -= 1;
-    tx_send_bit(self, self->message.message, self->step_index);
+    tx_send_field_bit(self, self->message.message, self->step_index);
     if (self->step_index == 0)
     {
         tx_set_state(self, TX_SEND_CRC);
     }
 }
 
+static void tx_state_process_send_bytes(TX_Device* self)
+{
+    self->step_index -= 1;
+    tx_send_field_bit(self, self->payload[self->byte_index], self->step_index);
+    if (self->step_index == 0)
+    {
+        self->byte_index += 1;
+        if (self->byte_index == self->payload_length)
+        {
+            tx_set_state(self, TX_SEND_CRC);
+        }
+        else
+        {
+            // Next byte
+            self->step_index = tx_field_line_bits(self, 8);
+            rf_crc16_add_byte(&(self->crc), self->payload[self->byte_index]);
+        }
+    }
+}
+
 static void tx_state_process_send_crc(TX_Device* self)
 {
     self->step_index -= 1;
-    tx_send_bit(self, self->message.message_crc, self->step_index);
+    tx_send_field_bit(self, self->message.message_crc, self->step_index);
     if (self->step_index == 0)
     {
+        self->stats.frames_sent += 1;
+        if (tx_dequeue_frame(self))
+        {
+            // Next frame follows without wake-up and sync
+            tx_set_state(self, self->config.frame_gap ? TX_FRAME_GAP_WAIT : TX_SEND_START);
+            return;
+        }
         tx_set_state(self, TX_INITIAL);
-        self->cancel_trigger(self->user_data);
-        self->tx_ready(self->user_data);   
-          
+        if (!self->edge_scheduled)
+        {
+            self->cancel_trigger(self->user_data);
+            self->tx_ready(self->user_data);   
+        }
+    }
+}
+
+static void tx_state_process_frame_gap(TX_Device* self)
+{
+    self->step_index -= 1;
+    tx_output(self, 0);
+    if (self->step_index == 0)
+    {
+        tx_set_state(self, TX_SEND_START);
     }
 }
 
 static void tx_set_state(TX_Device* self, TX_State state)
 {
-    TRACE("Setting state to %d", state);
+    TRACE(RF_TRACE_TX_STATE, state);
     self->state = state;
     switch (state)
     {
@@ -160,7 +480,7 @@ static void tx_set_state(TX_Device* self, TX_State state)
             break;
         case TX_SYNC:
             self->state_function = tx_state_process_sync;
-            self->step_index = SYNC_SYMBOL_LENGTH;   
+            self->step_index = self->config.sync_symbol_length;
             break;
         case TX_SEND_START:
             self->state_function = tx_state_process_send_start;
@@ -168,15 +488,31 @@ static void tx_set_state(TX_Device* self, TX_State state)
             break;
         case TX_SEND_LENGTH:
             self->state_function = tx_state_process_send_length;
-            self->step_index = PAYLOAD_LENGTH; // Based on max length
+            self->step_index = tx_field_line_bits(self, self->byte_mode ? PAYLOAD_BYTE_LENGTH : PAYLOAD_LENGTH); // Based on max length
+            // The CRC is updated with each field as it goes out
+            rf_crc16_init(&(self->crc));
+            rf_crc16_add_bits(&(self->crc), self->byte_mode ? self->payload_length : self->message.message_length,
+                              self->byte_mode ? PAYLOAD_BYTE_LENGTH : PAYLOAD_LENGTH);
             break;
         case TX_SEND_PAYLOAD:
             self->state_function = tx_state_process_send_payload;
-            self->step_index = self->message.message_length;
+            self->step_index = tx_field_line_bits(self, self->message.message_length);
+            rf_crc16_add_bits(&(self->crc), self->message.message, self->message.message_length);
+            break;
+        case TX_SEND_BYTES:
+            self->state_function = tx_state_process_send_bytes;
+            self->step_index = tx_field_line_bits(self, 8);
+            self->byte_index = 0;
+            rf_crc16_add_byte(&(self->crc), self->payload[0]);
             break;
         case TX_SEND_CRC:
             self->state_function = tx_state_process_send_crc;
-            self->step_index = 16;  // CRC is two bytes
+            self->message.message_crc = rf_crc16_value(&(self->crc));
+            self->step_index = tx_field_line_bits(self, 16);  // CRC is two bytes
+            break;
+        case TX_FRAME_GAP_WAIT:
+            self->state_function = tx_state_process_frame_gap;
+            self->step_index = self->config.frame_gap;
             break;
         
         default:
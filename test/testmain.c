@@ -3,35 +3,14 @@
 #include "pico/stdlib.h"
 #include "rf_pico.h"
 
-uint8_t times;
-uint64_t prev;
-bool got_message = false;
+#define DEDUP_TABLE_SIZE    8
+#define DEDUP_WINDOW_US     3000000     // Copies of a reading arrive within this
 
 void report_result(RF_Message* message)
 {
-    uint64_t const current_timestamp = to_us_since_boot(get_absolute_time());
-    times = (current_timestamp - prev) / 1000000ULL;
-            
-    if (!got_message)
-    {
-        // First message from burst
-        prev = current_timestamp;
-        printf("Received message: %llu, %x, %d, stamp: %d\n", message->message, message->message_length, message->message_crc, times);
-        got_message = true;
-    }
-    else if (got_message && times < 3)
-    {
-        // Second or third message from burst, just clear got_message
-        //got_message = false;
-    }
-    else if (got_message && times > 3)
-    {
-        // First message from burst, but missed from previous burst
-        prev = current_timestamp;
-        printf("Received message: %llu, %x, %d, stamp: %d\n", message->message, message->message_length, message->message_crc, times);
-        got_message = true;
-    }
-
+    // One call per reading, the repeated copies are dropped by the receiver
+    printf("Received message: %llu, %x, %d, stamp: %llu\n", message->message, message->message_length,
+           message->message_crc, to_us_since_boot(get_absolute_time()) / 1000000ULL);
 }
 
 int main (void)
@@ -46,7 +25,7 @@ int main (void)
     message.message = 12345;
     message.message_length = 14;
     message.message_crc = 0x2222;
-    pico_init_transmitter(&trans);
+    pico_init_transmitter(&trans, NULL);
    // LED_PIN_PUT(LED_PIN, 1);
     printf("Sending\n");
 
@@ -55,6 +34,9 @@ int main (void)
     while (1)
     {
         sleep_ms(5000);
+        // Burst of three copies, sent back to back after one preamble
+        pico_tx_send_message(&trans, &message);
+        pico_tx_send_message(&trans, &message);
         pico_tx_send_message(&trans, &message);
 
     }
@@ -65,13 +47,23 @@ int main (void)
 
 
     rf_pico_receiver rec;
-    pico_init_receiver(&rec, report_result);
+    RF_Message queue[8];
+    RX_Dedup_Entry dedup_table[DEDUP_TABLE_SIZE];
+    RF_Message message;
+    pico_init_receiver(&rec, report_result, NULL);
+    pico_rx_set_message_queue(&rec, queue, 8);
+    pico_rx_set_dedup_filter(&rec, dedup_table, DEDUP_TABLE_SIZE, DEDUP_WINDOW_US, 0);
     sleep_ms(1000);
     pico_rx_start_receiving(&rec);
     
     while (1)
     {
-        sleep_ms(2000);
+        // Print outside of the timer interrupt
+        while (pico_rx_poll_message(&rec, &message))
+        {
+            report_result(&message);
+        }
+        sleep_ms(10);
     }    
     
 }